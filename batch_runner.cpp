@@ -0,0 +1,338 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *   batch_runner.cpp - determinizes many automata in one process (--batch)   *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <thread>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "batch_runner.h"
+#include "buechi_reader.h"
+#include "hoa_reader.h"
+#include "output_buffer.h"
+#include "rabin_minimizer.h"
+#include "rabin_writer.h"
+#include "safra_explorer.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double MillisecondsSince(const Clock::time_point &start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static bool EndsWith(const std::string &text, const char *suffix) {
+    size_t length = strlen(suffix);
+    return text.size() >= length &&
+        text.compare(text.size() - length, length, suffix) == 0;
+}
+
+/*
+ * output_directory/<input file name, with .aut / .hoa replaced by .txt>. The
+ *   k-th use of a name (counted in uses) gets a "_k" suffix from the second
+ *   use on, so that no two jobs write the same file.
+ */
+static std::string OutputFileName(const std::string &input_file_name,
+    const char *output_directory, std::map<std::string, int> &uses) {
+
+    std::string name = input_file_name.substr(
+        input_file_name.find_last_of('/') + 1);
+    if (EndsWith(name, ".aut") || EndsWith(name, ".hoa")) {
+        name.erase(name.size() - 4);
+    }
+
+    int use = ++uses[name];
+    if (use > 1) {
+        name += "_" + std::to_string(use);
+    }
+    return std::string(output_directory) + "/" + name + ".txt";
+}
+
+
+// ========================================================================== //
+// ========================== Listing the jobs ============================== //
+// ========================================================================== //
+
+bool ListBatchJobs(const char *path, const char *output_directory,
+    std::vector<BatchJob> &jobs, std::string &error) {
+
+    std::vector<std::string> input_file_names;
+
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        error = std::string("cannot read ") + path;
+        return false;
+    }
+
+    if (S_ISDIR(info.st_mode)) {
+        DIR *directory = opendir(path);
+        if (directory == NULL) {
+            error = std::string("cannot list directory ") + path;
+            return false;
+        }
+
+        struct dirent *entry;
+        while ((entry = readdir(directory)) != NULL) {
+            std::string name = entry->d_name;
+            if (EndsWith(name, ".aut") || EndsWith(name, ".hoa")) {
+                input_file_names.push_back(std::string(path) + "/" + name);
+            }
+        }
+        closedir(directory);
+
+        std::sort(input_file_names.begin(), input_file_names.end());
+    }
+    else {
+        std::ifstream manifest(path);
+        if (!manifest) {
+            error = std::string("cannot read manifest ") + path;
+            return false;
+        }
+
+        std::string line;
+        while (std::getline(manifest, line)) {
+            if (!line.empty() && line[line.size() - 1] == '\r') {
+                line.erase(line.size() - 1);
+            }
+            if (!line.empty() && line[0] != '#') {
+                input_file_names.push_back(line);
+            }
+        }
+    }
+
+    jobs.clear();
+    std::map<std::string, int> uses;
+
+    for (const std::string &input_file_name : input_file_names) {
+        BatchJob job = BatchJob();
+        job.input_file_name = input_file_name;
+        job.output_file_name = OutputFileName(input_file_name, output_directory,
+            uses);
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+
+// ========================================================================== //
+// ========================== Running the jobs ============================== //
+// ========================================================================== //
+
+/*
+ * Everything one batch thread reuses from job to job: an explorer for each
+ *   state set width (created when the first job of that width comes along)
+ *   and the output buffer.
+ */
+class BatchWorker {
+public:
+
+    BatchWorker(bool canonical_labels, bool minimize);
+    ~BatchWorker();
+
+    void RunJob(BatchJob &job);
+
+private:
+    BatchWorker(const BatchWorker &);
+    BatchWorker &operator=(const BatchWorker &);
+
+    template <int W>
+    void Determinize(BatchJob &job, const BuchiAutomaton &automaton);
+
+    template <int W>
+    SafraExplorer<W> *&ExplorerFor();
+
+    bool canonical_labels_;
+    bool minimize_;
+    OutputBuffer out_;
+
+#define DECLARE_BATCH_EXPLORER(W) SafraExplorer<W> *explorer_##W##_;
+    SAFRA_FOR_EACH_WIDTH(DECLARE_BATCH_EXPLORER)
+#undef DECLARE_BATCH_EXPLORER
+};
+
+#define DEFINE_EXPLORER_FOR(W)                                                  \
+    template <>                                                                 \
+    SafraExplorer<W> *&BatchWorker::ExplorerFor<W>() {                          \
+        return explorer_##W##_;                                                 \
+    }
+SAFRA_FOR_EACH_WIDTH(DEFINE_EXPLORER_FOR)
+#undef DEFINE_EXPLORER_FOR
+
+
+BatchWorker::BatchWorker(bool canonical_labels, bool minimize) {
+    canonical_labels_ = canonical_labels;
+    minimize_ = minimize;
+
+#define INITIALIZE_BATCH_EXPLORER(W) explorer_##W##_ = NULL;
+    SAFRA_FOR_EACH_WIDTH(INITIALIZE_BATCH_EXPLORER)
+#undef INITIALIZE_BATCH_EXPLORER
+}
+
+BatchWorker::~BatchWorker() {
+#define DELETE_BATCH_EXPLORER(W) delete explorer_##W##_;
+    SAFRA_FOR_EACH_WIDTH(DELETE_BATCH_EXPLORER)
+#undef DELETE_BATCH_EXPLORER
+}
+
+/*
+ * Parses, determinizes & writes one file, recording the outcome in job
+ */
+void BatchWorker::RunJob(BatchJob &job) {
+
+    Clock::time_point start = Clock::now();
+
+    MappedFile infile;
+    if (!infile.Open(job.input_file_name.c_str())) {
+        job.error = "improper input filename";
+        return;
+    }
+
+    BuchiAutomaton automaton;
+    int num_states;
+    std::string error;
+    std::vector<std::string> atomic_propositions;
+
+    if (IsHoa(infile.GetData(), infile.GetSize()) ?
+        !ParseHoa(infile.GetData(), infile.GetSize(), automaton, num_states,
+            atomic_propositions, error) :
+        !ParseBuechi(infile.GetData(), infile.GetSize(), automaton, num_states,
+            error)) {
+        job.error = "improperly formatted input file (" + error + ")";
+        return;
+    }
+
+    job.buechi_states = num_states;
+    job.parse_ms = MillisecondsSince(start);
+
+    switch (automaton.GetNumWords()) {
+#define DETERMINIZE_WITH_WIDTH(W)                                               \
+        case W:                                                                 \
+            Determinize<W>(job, automaton);                                     \
+            break;
+        SAFRA_FOR_EACH_WIDTH(DETERMINIZE_WITH_WIDTH)
+#undef DETERMINIZE_WITH_WIDTH
+        default:
+            job.error = "no state set width for this automaton";
+            break;
+    }
+}
+
+template <int W>
+void BatchWorker::Determinize(BatchJob &job, const BuchiAutomaton &automaton) {
+
+    Clock::time_point start = Clock::now();
+
+    SafraExplorer<W> *&explorer = ExplorerFor<W>();
+    if (explorer == NULL) {
+        explorer = new SafraExplorer<W>(&automaton, 1, canonical_labels_,
+            SafraAllocator());
+    }
+    else {
+        explorer->Reset(&automaton);
+    }
+    explorer->Run();
+
+    const RabinAutomaton *rabin = &explorer->GetRabinAutomaton();
+
+    // With --minimize, each state shows the tree of its representative
+    RabinAutomaton minimized;
+    std::vector<int> representatives;
+    const std::vector<int> *tree_states = NULL;
+
+    if (minimize_) {
+        minimized = MinimizeRabin(*rabin, representatives);
+        rabin = &minimized;
+        tree_states = &representatives;
+    }
+
+    job.rabin_states = rabin->GetNumStates();
+    job.explore_ms = MillisecondsSince(start);
+
+    start = Clock::now();
+
+    if (!out_.Open(job.output_file_name.c_str())) {
+        job.error = "improper output filename";
+        return;
+    }
+    WriteRabin<W>(out_, job.input_file_name.c_str(), *rabin, *explorer,
+        tree_states);
+    if (!out_.Close()) {
+        job.error = "could not write output file";
+        return;
+    }
+
+    job.write_ms = MillisecondsSince(start);
+    job.ok = true;
+}
+
+
+void RunBatch(std::vector<BatchJob> &jobs, int num_threads,
+    bool canonical_labels, bool minimize) {
+
+    std::atomic<size_t> next_job(0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads && t < (int) jobs.size(); t++) {
+        threads.push_back(std::thread([&]() {
+            BatchWorker worker(canonical_labels, minimize);
+            for (size_t i = next_job++; i < jobs.size(); i = next_job++) {
+                worker.RunJob(jobs[i]);
+            }
+        }));
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+
+// ========================================================================== //
+// ============================ Batch summary =============================== //
+// ========================================================================== //
+
+/*
+ * Quotes a CSV field, since file names & error messages may contain commas
+ */
+static std::string CsvField(const std::string &text) {
+    std::string field = "\"";
+    for (char c : text) {
+        if (c == '"') { field += '"'; }
+        field += c;
+    }
+    return field + "\"";
+}
+
+bool WriteBatchSummary(const char *file_name, const std::vector<BatchJob> &jobs) {
+
+    FILE *file = fopen(file_name, "w");
+    if (file == NULL) {
+        return false;
+    }
+
+    fprintf(file, "input,output,status,buechi_states,rabin_states,parse_ms,"
+        "explore_ms,write_ms\n");
+
+    for (const BatchJob &job : jobs) {
+        fprintf(file, "%s,%s,%s,%d,%d,%.3f,%.3f,%.3f\n",
+            CsvField(job.input_file_name).c_str(),
+            CsvField(job.output_file_name).c_str(),
+            CsvField(job.ok ? "ok" : job.error).c_str(), job.buechi_states,
+            job.rabin_states, job.parse_ms, job.explore_ms, job.write_ms);
+    }
+
+    return fclose(file) == 0;
+}
@@ -0,0 +1,63 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *    batch_runner.h - determinizes many automata in one process (--batch)    *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Name of the per-file summary written next to the outputs of a batch
+#define BATCH_SUMMARY_FILE_NAME "batch_summary.csv"
+
+/*
+ * One input file of a batch, & what became of it
+ */
+struct BatchJob {
+    std::string input_file_name;
+    std::string output_file_name;
+
+    bool ok;
+    std::string error;          // why the job failed, if !ok
+
+    int buechi_states;
+    int rabin_states;
+    double parse_ms;
+    double explore_ms;          // exploration, renumbering & minimizing
+    double write_ms;
+};
+
+/*
+ * Lists the jobs of a batch: every .aut & .hoa file directly inside path if
+ *   it is a directory (in name order), and otherwise every non-empty line of
+ *   the manifest file path that does not start with '#'. Each output is
+ *   written to output_directory under the input's name, with .aut / .hoa
+ *   replaced by .txt (and "_2", "_3", ... appended when the same name comes
+ *   up again).
+ *
+ * Returns false, with a description in error, if path cannot be read.
+ */
+bool ListBatchJobs(const char *path, const char *output_directory,
+    std::vector<BatchJob> &jobs, std::string &error);
+
+/*
+ * Runs every job on num_threads threads, each of which takes the next
+ *   unstarted job whenever it finishes one. A thread keeps its explorers
+ *   (one per state set width), with their node arenas & hash tables, and its
+ *   output buffer from one job to the next. Each job is explored by a single
+ *   thread, & its output is the same as './safra' would write.
+ */
+void RunBatch(std::vector<BatchJob> &jobs, int num_threads,
+    bool canonical_labels, bool minimize);
+
+/*
+ * Writes one CSV line per job (status, sizes & timings) to file_name.
+ *   Returns false if the file cannot be written.
+ */
+bool WriteBatchSummary(const char *file_name, const std::vector<BatchJob> &jobs);
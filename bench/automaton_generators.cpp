@@ -0,0 +1,158 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *  automaton_generators.cpp - scalable Buechi automata for benchmarking      *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include <cassert>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "automaton_generators.h"
+
+namespace {
+
+// A transition, 1-indexed as in the file format
+struct Transition {
+    int pre_state;
+    int character;
+    int post_state;
+};
+
+/*
+ * Builds the .aut text of an automaton from its parts
+ */
+std::string FormatAutomaton(const std::string &name, int num_states,
+    int alphabet_size, const std::vector<Transition> &transitions,
+    const std::vector<int> &initial_states,
+    const std::vector<int> &final_states) {
+
+    std::ostringstream stream;
+
+    stream << "BUECHI\n";
+    stream << "# Generated: " << name << "\n";
+    stream << "# Number of states\n" << num_states << "\n";
+    stream << "# Alphabet size\n" << alphabet_size << "\n";
+    stream << "# Number of transitions\n" << transitions.size() << "\n";
+    stream << "# begin transitions\n";
+    for (const Transition &t : transitions) {
+        stream << t.pre_state << "  " << t.character << "  " << t.post_state << "\n";
+    }
+    stream << "# end transitions\n";
+
+    stream << "# Buechi initial\n";
+    for (int state : initial_states) { stream << state << " "; }
+    stream << "\n# Buechi final\n";
+    for (int state : final_states) { stream << state << " "; }
+    stream << "\n# Buechi eof\n";
+
+    return stream.str();
+}
+
+/*
+ * The littlemonster transitions over states 1..hub and letters 1..hub
+ */
+void AddLittleMonster(int hub, std::vector<Transition> &transitions) {
+
+    for (int i = 1; i < hub; i++) {
+        for (int c = 1; c <= hub; c++) {
+            transitions.push_back({ i, c, i });
+            if (c == i) {
+                transitions.push_back({ i, c, hub });
+            }
+        }
+    }
+    for (int i = 1; i < hub; i++) {
+        transitions.push_back({ hub, i, i });
+    }
+}
+
+} // namespace
+
+
+bool IsKnownFamily(const std::string &family) {
+    return family == "monster" || family == "littlemonster" ||
+        family == "buechi" || family == "random";
+}
+
+int MinimumSize(const std::string &family) {
+    if (family == "monster") { return 3; }
+    if (family == "littlemonster" || family == "buechi") { return 2; }
+    return 1;
+}
+
+std::string GenerateAutomaton(const GeneratorParams &params) {
+
+    assert(IsKnownFamily(params.family) && params.n >= MinimumSize(params.family));
+
+    int n = params.n;
+    std::string name = params.family + "(" + std::to_string(n) + ")";
+    std::vector<Transition> transitions;
+
+    if (params.family == "littlemonster") {
+        AddLittleMonster(n, transitions);
+        return FormatAutomaton(name, n, n, transitions, { n }, { n });
+    }
+
+    if (params.family == "monster") {
+        int hub = n - 1;
+        AddLittleMonster(hub, transitions);
+        transitions.push_back({ hub, hub, n });
+        for (int c = 1; c <= hub; c++) {
+            transitions.push_back({ n, c, n });
+        }
+        return FormatAutomaton(name, n, hub, transitions, { hub }, { hub });
+    }
+
+    if (params.family == "buechi") {
+        transitions.push_back({ 1, 1, 1 });
+        transitions.push_back({ 1, 2, 1 });
+        transitions.push_back({ 1, 1, 2 });
+        for (int i = 2; i <= n; i++) {
+            transitions.push_back({ i, 1, (i < n ? i + 1 : 2) });
+        }
+        return FormatAutomaton(name, n, 2, transitions, { 1 }, { n });
+    }
+
+    // random
+    std::mt19937_64 generator(params.seed);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    double edge_probability = params.density / n;
+
+    for (int i = 1; i <= n; i++) {
+        for (int c = 1; c <= params.alphabet_size; c++) {
+            for (int j = 1; j <= n; j++) {
+                if (coin(generator) < edge_probability) {
+                    transitions.push_back({ i, c, j });
+                }
+            }
+        }
+    }
+
+    // The file format requires at least one transition
+    if (transitions.empty()) {
+        transitions.push_back({ 1, 1, 1 });
+    }
+
+    std::vector<int> final_states;
+    for (int i = 1; i <= n; i++) {
+        if (coin(generator) < params.final_ratio) {
+            final_states.push_back(i);
+        }
+    }
+    if (final_states.empty()) {
+        final_states.push_back(1 + generator() % n);
+    }
+
+    name += " alphabet=" + std::to_string(params.alphabet_size) +
+        " density=" + std::to_string(params.density) +
+        " final_ratio=" + std::to_string(params.final_ratio) +
+        " seed=" + std::to_string(params.seed);
+    return FormatAutomaton(name, n, params.alphabet_size, transitions, { 1 },
+        final_states);
+}
@@ -0,0 +1,51 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *   automaton_generators.h - scalable Buechi automata for benchmarking       *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*
+ * Parameters of a generated automaton. Every family is scaled by n, the
+ *   number of Buechi states; the other fields are only used by "random".
+ */
+struct GeneratorParams {
+    std::string family;   // monster, littlemonster, buechi or random
+    int n;
+    int alphabet_size;    // random: number of letters
+    double density;       // random: expected successors per (state, letter)
+    double final_ratio;   // random: probability that a state is final
+    uint64_t seed;        // random: seed of the generator
+};
+
+// Returns false if family is not one of the generated families
+bool IsKnownFamily(const std::string &family);
+
+// Smallest n the family is defined for
+int MinimumSize(const std::string &family);
+
+/*
+ * Returns the .aut text (format in info.txt) of the automaton described by
+ *   params. The families generalize the hand-written automata in test/:
+ *
+ *   littlemonster(n): letters 1..n, hub state n (initial & final). Every
+ *     other state i loops on every letter and also moves to n on letter i;
+ *     the hub moves back to i on letter i. littlemonsterN.aut for N = 3..5.
+ *   monster(n): littlemonster(n-1) plus a sink state n that the hub reaches
+ *     on its own letter. monsterN.aut for N = 3..5.
+ *   buechi(n): "eventually only a's" over {a, b}: state 1 loops on both
+ *     letters and guesses the a-cycle 2 -> 3 -> ... -> n -> 2, whose last
+ *     state is final. buechi1.aut for n = 2.
+ *   random(n): every (state, letter, state) triple is a transition with
+ *     probability density / n, every state is final with probability
+ *     final_ratio (at least one is), and state 1 is initial.
+ */
+std::string GenerateAutomaton(const GeneratorParams &params);
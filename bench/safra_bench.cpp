@@ -0,0 +1,419 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *     safra_bench.cpp - benchmarks Safra's algorithm on generated automata   *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../buechi_reader.h"
+#include "../output_buffer.h"
+#include "../rabin_writer.h"
+#include "../safra_explorer.h"
+#include "automaton_generators.h"
+
+#define USAGE \
+    "Usage: ./bench/safra_bench [options]\n" \
+    "  --family F        monster, littlemonster, buechi or random (default monster)\n" \
+    "  --sizes A..B|A,B  Buechi sizes n to run (default 3..6)\n" \
+    "  --alphabet K      random: number of letters (default 2)\n" \
+    "  --density D       random: expected successors per state & letter (default 1.5)\n" \
+    "  --final-ratio F   random: fraction of final states (default 0.5)\n" \
+    "  --seed S          random: generator seed (default 1)\n" \
+    "  --threads N       explorer worker threads (default 1)\n" \
+    "  --repeat R        runs per size (default 1)\n" \
+    "  --timeout SEC     per-run limit; larger sizes are skipped after one\n" \
+    "                    times out (default 600)\n" \
+    "  --format csv|json result format (default csv)\n" \
+    "  --emit DIR        write the generated .aut files to DIR instead\n"
+
+// ========================================================================== //
+// ========================= Counting heap allocations ====================== //
+// ========================================================================== //
+
+// Number of calls to operator new in this process
+static std::atomic<uint64_t> num_allocations(0);
+
+void *operator new(size_t size) {
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == NULL) { throw std::bad_alloc(); }
+    return p;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+
+// ========================================================================== //
+// ============================ Running one case ============================ //
+// ========================================================================== //
+
+// Measurements of one run, passed from the child process back to the parent
+struct BenchResult {
+    int ok;
+    int buechi_states;
+    int alphabet_size;
+    int rabin_states;
+    double parse_ms;
+    double explore_ms;
+    double write_ms;
+    double wall_ms;
+    uint64_t allocations;
+    uint64_t output_bytes;
+    long peak_rss_kb;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static double MillisecondsSince(const Clock::time_point &start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/*
+ * Explores & writes automaton using W-word state sets, filling in result
+ */
+template <int W>
+void ExploreAndWrite(const BuchiAutomaton &automaton, int num_threads,
+    const char *output_file_name, BenchResult &result) {
+
+    Clock::time_point start = Clock::now();
+
+    SafraExplorer<W> explorer(&automaton, num_threads, false,
+        SafraAllocator());
+    explorer.Run();
+    const RabinAutomaton &rabin = explorer.GetRabinAutomaton();
+
+    result.explore_ms = MillisecondsSince(start);
+    result.rabin_states = rabin.GetNumStates();
+
+    start = Clock::now();
+
+    OutputBuffer out;
+    if (!out.Open(output_file_name)) {
+        return;
+    }
+    WriteRabin<W>(out, "<generated>", rabin, explorer, NULL);
+    if (!out.Close()) {
+        return;
+    }
+
+    result.write_ms = MillisecondsSince(start);
+    result.ok = 1;
+}
+
+/*
+ * Runs the whole pipeline (parse, explore, write) on the generated text.
+ *   Called in a child process, so peak RSS covers this run only.
+ */
+static BenchResult RunCase(const std::string &text, int num_threads,
+    const char *output_file_name) {
+
+    BenchResult result;
+    memset(&result, 0, sizeof(result));
+
+    uint64_t allocations_before = num_allocations.load();
+    Clock::time_point start = Clock::now();
+
+    BuchiAutomaton automaton;
+    int num_states;
+    std::string error;
+    if (!ParseBuechi(text.data(), text.size(), automaton, num_states, error)) {
+        std::cerr << "ERROR: generated automaton rejected: " << error << std::endl;
+        return result;
+    }
+    result.parse_ms = MillisecondsSince(start);
+    result.buechi_states = automaton.GetNumStates();
+    result.alphabet_size = automaton.GetAlphabetSize();
+
+    switch (automaton.GetNumWords()) {
+#define EXPLORE_WITH_WIDTH(W)                                                   \
+        case W:                                                                 \
+            ExploreAndWrite<W>(automaton, num_threads, output_file_name, result); \
+            break;
+        SAFRA_FOR_EACH_WIDTH(EXPLORE_WITH_WIDTH)
+#undef EXPLORE_WITH_WIDTH
+        default:
+            break;
+    }
+
+    result.wall_ms = MillisecondsSince(start);
+    result.allocations = num_allocations.load() - allocations_before;
+
+    struct stat info;
+    if (stat(output_file_name, &info) == 0) {
+        result.output_bytes = info.st_size;
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    result.peak_rss_kb = usage.ru_maxrss;
+
+    return result;
+}
+
+/*
+ * Runs one case in a forked child with a time limit. Returns "ok", "timeout"
+ *   or "failed"; result is only filled in for "ok".
+ */
+static std::string RunIsolated(const std::string &text, int num_threads,
+    int timeout, BenchResult &result) {
+
+    char output_file_name[] = "/tmp/safra_bench_XXXXXX";
+    int output_fd = mkstemp(output_file_name);
+    if (output_fd < 0) {
+        return "failed";
+    }
+    close(output_fd);
+
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        unlink(output_file_name);
+        return "failed";
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        close(pipe_fds[0]);
+        alarm(timeout);
+
+        BenchResult child_result = RunCase(text, num_threads, output_file_name);
+        ssize_t written = write(pipe_fds[1], &child_result, sizeof(child_result));
+        _exit(written == (ssize_t) sizeof(child_result) ? 0 : 1);
+    }
+
+    close(pipe_fds[1]);
+
+    std::string status = "failed";
+    if (pid > 0) {
+        ssize_t bytes = read(pipe_fds[0], &result, sizeof(result));
+
+        int wait_status;
+        waitpid(pid, &wait_status, 0);
+
+        if (WIFSIGNALED(wait_status) && WTERMSIG(wait_status) == SIGALRM) {
+            status = "timeout";
+        }
+        else if (bytes == (ssize_t) sizeof(result) && result.ok) {
+            status = "ok";
+        }
+    }
+
+    close(pipe_fds[0]);
+    unlink(output_file_name);
+    return status;
+}
+
+
+// ========================================================================== //
+// ================================ Reporting =============================== //
+// ========================================================================== //
+
+static void PrintHeader(const std::string &format) {
+    if (format == "csv") {
+        std::cout << "family,n,buechi_states,alphabet,threads,status,"
+            "rabin_states,parse_ms,explore_ms,write_ms,wall_ms,trees_per_sec,"
+            "peak_rss_kb,allocations,output_bytes" << std::endl;
+    }
+    else {
+        std::cout << "[";
+    }
+}
+
+static void PrintRow(const std::string &format, bool first,
+    const GeneratorParams &params, int num_threads, const std::string &status,
+    const BenchResult &result) {
+
+    double trees_per_sec = (result.explore_ms > 0 ?
+        result.rabin_states / (result.explore_ms / 1000.0) : 0.0);
+
+    char line[512];
+
+    if (format == "csv") {
+        snprintf(line, sizeof(line), "%s,%d,%d,%d,%d,%s,%d,%.3f,%.3f,%.3f,%.3f,"
+            "%.0f,%ld,%llu,%llu", params.family.c_str(), params.n,
+            result.buechi_states, result.alphabet_size, num_threads,
+            status.c_str(), result.rabin_states, result.parse_ms,
+            result.explore_ms, result.write_ms, result.wall_ms, trees_per_sec,
+            result.peak_rss_kb, (unsigned long long) result.allocations,
+            (unsigned long long) result.output_bytes);
+    }
+    else {
+        snprintf(line, sizeof(line), "%s\n  {\"family\": \"%s\", \"n\": %d, "
+            "\"buechi_states\": %d, \"alphabet\": %d, \"threads\": %d, "
+            "\"status\": \"%s\", \"rabin_states\": %d, \"parse_ms\": %.3f, "
+            "\"explore_ms\": %.3f, \"write_ms\": %.3f, \"wall_ms\": %.3f, "
+            "\"trees_per_sec\": %.0f, \"peak_rss_kb\": %ld, "
+            "\"allocations\": %llu, \"output_bytes\": %llu}",
+            (first ? "" : ","), params.family.c_str(), params.n,
+            result.buechi_states, result.alphabet_size, num_threads,
+            status.c_str(), result.rabin_states, result.parse_ms,
+            result.explore_ms, result.write_ms, result.wall_ms, trees_per_sec,
+            result.peak_rss_kb, (unsigned long long) result.allocations,
+            (unsigned long long) result.output_bytes);
+    }
+
+    std::cout << line;
+    if (format == "csv") { std::cout << "\n"; }
+    std::cout.flush();
+}
+
+
+// ========================================================================== //
+// =================================== Main ================================= //
+// ========================================================================== //
+
+/*
+ * Parses "A..B" or a comma-separated list of sizes into sizes
+ */
+static bool ParseSizes(const char *text, std::vector<int> &sizes) {
+
+    sizes.clear();
+    const char *range = strstr(text, "..");
+    if (range != NULL) {
+        int low = atoi(text), high = atoi(range + 2);
+        for (int n = low; n <= high; n++) { sizes.push_back(n); }
+        return low <= high;
+    }
+
+    for (const char *p = text; *p != '\0'; ) {
+        sizes.push_back(atoi(p));
+        p = strchr(p, ',');
+        if (p == NULL) { break; }
+        p++;
+    }
+    return !sizes.empty();
+}
+
+int main(int argc, const char *argv[]) {
+
+    GeneratorParams params = { "monster", 0, 2, 1.5, 0.5, 1 };
+    std::vector<int> sizes = { 3, 4, 5, 6 };
+    int num_threads = 1, repeat = 1, timeout = 600;
+    std::string format = "csv";
+    const char *emit_dir = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << USAGE;
+            return 1;
+        }
+        const char *value = argv[++i];
+
+        if (option == "--family") { params.family = value; }
+        else if (option == "--sizes") {
+            if (!ParseSizes(value, sizes)) {
+                std::cerr << "ERROR: Bad size list." << std::endl;
+                return 1;
+            }
+        }
+        else if (option == "--alphabet") { params.alphabet_size = atoi(value); }
+        else if (option == "--density") { params.density = atof(value); }
+        else if (option == "--final-ratio") { params.final_ratio = atof(value); }
+        else if (option == "--seed") { params.seed = strtoull(value, NULL, 10); }
+        else if (option == "--threads") { num_threads = atoi(value); }
+        else if (option == "--repeat") { repeat = atoi(value); }
+        else if (option == "--timeout") { timeout = atoi(value); }
+        else if (option == "--format") { format = value; }
+        else if (option == "--emit") { emit_dir = value; }
+        else {
+            std::cerr << USAGE;
+            return 1;
+        }
+    }
+
+    if (!IsKnownFamily(params.family) || (format != "csv" && format != "json") ||
+        num_threads < 1 || repeat < 1 || timeout < 1 || params.alphabet_size < 1) {
+        std::cerr << USAGE;
+        return 1;
+    }
+
+    for (int n : sizes) {
+        if (n < MinimumSize(params.family) || StateWordsFor(n) < 0) {
+            std::cerr << "ERROR: Size " << n << " is out of range for family ";
+            std::cerr << params.family << "." << std::endl;
+            return 1;
+        }
+    }
+
+    // Only write out the generated automata
+    if (emit_dir != NULL) {
+        for (int n : sizes) {
+            params.n = n;
+            std::string file_name = std::string(emit_dir) + "/" +
+                params.family + std::to_string(n) + ".aut";
+            FILE *file = fopen(file_name.c_str(), "w");
+            if (file == NULL) {
+                std::cerr << "ERROR: Cannot write " << file_name << std::endl;
+                return 1;
+            }
+            std::string text = GenerateAutomaton(params);
+            fwrite(text.data(), 1, text.size(), file);
+            fclose(file);
+        }
+        return 0;
+    }
+
+    PrintHeader(format);
+    bool first = true;
+
+    for (int n : sizes) {
+        params.n = n;
+        std::string text = GenerateAutomaton(params);
+        bool timed_out = false;
+
+        for (int r = 0; r < repeat; r++) {
+            BenchResult result;
+            memset(&result, 0, sizeof(result));
+
+            std::string status = RunIsolated(text, num_threads, timeout, result);
+            PrintRow(format, first, params, num_threads, status, result);
+            first = false;
+
+            if (status == "timeout") {
+                timed_out = true;
+                break;
+            }
+        }
+
+        // Larger members of the family will not finish either
+        if (timed_out) {
+            break;
+        }
+    }
+
+    if (format == "json") {
+        std::cout << "\n]" << std::endl;
+    }
+    return 0;
+}
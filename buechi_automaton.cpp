@@ -0,0 +1,120 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *     buechi_automaton.cpp - Buechi automaton shared by all Safra trees      *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include "buechi_automaton.h"
+
+BuchiAutomaton::BuchiAutomaton() {
+    num_states_ = 0;
+    alphabet_size_ = 0;
+    num_words_ = 0;
+    num_chunks_ = 0;
+}
+
+BuchiAutomaton::BuchiAutomaton(int num_states, int alphabet_size) {
+
+    assert(num_states > 0 && StateWordsFor(num_states) > 0);
+
+    num_states_ = num_states;
+    alphabet_size_ = alphabet_size;
+    num_words_ = StateWordsFor(num_states);
+    num_chunks_ = (num_states + 7) / 8;
+
+    transitions_ = std::vector<uint64_t>(
+        alphabet_size * num_states * num_words_, 0);
+    initial_states_ = std::vector<uint64_t>(num_words_, 0);
+    final_states_ = std::vector<uint64_t>(num_words_, 0);
+}
+
+
+// ========================= Building the automaton ========================= //
+
+/*
+ * Insert a transition from state #pre to state #post along character
+ */
+void BuchiAutomaton::AddTransition(const int &pre_state, const int &character,
+    const int &post_state) {
+
+    assert(pre_state >= 0 && pre_state < num_states_);
+    assert(post_state >= 0 && post_state < num_states_);
+    assert(character >= 0 && character < alphabet_size_);
+
+    InsertState(&transitions_[(pre_state * alphabet_size_ + character) * num_words_],
+        post_state);
+}
+
+void BuchiAutomaton::AddInitialState(const int &state) {
+    assert(state >= 0 && state < num_states_);
+    InsertState(&initial_states_[0], state);
+}
+
+void BuchiAutomaton::AddFinalState(const int &state) {
+    assert(state >= 0 && state < num_states_);
+    InsertState(&final_states_[0], state);
+}
+
+
+/*
+ * Fills image_tables_. Within a chunk, the image of a subset is the image of
+ *   the subset without its lowest state, plus that state's successors, so
+ *   each table entry costs a single union.
+ */
+void BuchiAutomaton::PrecomputeImages() {
+
+    // Number of words in the images of one subset along every character
+    size_t row_words = (size_t) alphabet_size_ * num_words_;
+
+    size_t table_words = (size_t) num_chunks_ * 256 * row_words;
+    if (table_words * sizeof(uint64_t) > IMAGE_TABLE_BUDGET) {
+        image_tables_.clear();
+        return;
+    }
+
+    image_tables_ = std::vector<uint64_t>(table_words, 0);
+
+    for (int chunk = 0; chunk < num_chunks_; chunk++) {
+
+        uint64_t *table = &image_tables_[chunk * 256 * row_words];
+
+        for (int subset = 1; subset < 256; subset++) {
+            int state = chunk * 8 + LowestBit(subset);
+            uint64_t *entry = &table[subset * row_words];
+            const uint64_t *rest = &table[(subset & (subset - 1)) * row_words];
+
+            for (size_t w = 0; w < row_words; w++) {
+                entry[w] = rest[w];
+                if (state < num_states_) {
+                    entry[w] |= transitions_[state * row_words + w];
+                }
+            }
+        }
+    }
+}
+
+
+// ============================= Access methods ============================= //
+
+int BuchiAutomaton::GetNumStates() const {
+    return num_states_;
+}
+
+int BuchiAutomaton::GetAlphabetSize() const {
+    return alphabet_size_;
+}
+
+int BuchiAutomaton::GetNumWords() const {
+    return num_words_;
+}
+
+
+// ========================= Private helper methods ========================= //
+
+void BuchiAutomaton::InsertState(uint64_t *set, const int &state) {
+    set[state / BITS_PER_WORD] |= (uint64_t(1) << (state % BITS_PER_WORD));
+}
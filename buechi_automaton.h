@@ -0,0 +1,179 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *      buechi_automaton.h - Buechi automaton shared by all Safra trees       *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <cstdint>
+#include <cassert>
+#include <vector>
+
+#include "state_set.h"
+
+// Words with at most this many states take the state-by-state image path
+#define SPARSE_WORD_BITS 2
+
+// Upper bound (in bytes) on the memory spent on precomputed image tables
+#define IMAGE_TABLE_BUDGET (64 << 20)
+
+/*
+ * A nondeterministic Buechi automaton: states 0..n-1, letters 0..|Sigma|-1, a
+ *   transition relation, initial states I and final states F. It is filled in
+ *   once (by the parser) and then only read, so every Safra tree of a run
+ *   refers to one shared instance instead of carrying its own copy.
+ *
+ * All state sets are stored as GetNumWords() consecutive 64-bit words, where
+ *   the width is the one picked by StateWordsFor(n); the templated accessors
+ *   hand them out as StateSet<W> for that same W.
+ */
+class BuchiAutomaton {
+public:
+
+    BuchiAutomaton();
+    BuchiAutomaton(int num_states, int alphabet_size);
+
+    // Building the automaton (states and characters are 0-indexed)
+    void AddTransition(const int &pre_state, const int &character,
+        const int &post_state);
+    void AddInitialState(const int &state);
+    void AddFinalState(const int &state);
+
+    // Builds the per-letter image tables used by GetImage. Call once, after
+    //   every transition has been added.
+    void PrecomputeImages();
+
+    // Access methods
+    int GetNumStates() const;
+    int GetAlphabetSize() const;
+    int GetNumWords() const;
+
+    template <int W>
+    StateSet<W> GetTransition(const int &state, const int &character) const {
+        assert(W == num_words_);
+        return StateSet<W>::FromWords(
+            &transitions_[(state * alphabet_size_ + character) * W]);
+    }
+
+    /*
+     * Returns the image of states along character, i.e. the union of the
+     *   successors of every state in states. Words with at most
+     *   SPARSE_WORD_BITS members are handled one state at a time (popcount /
+     *   count-trailing-zeros), denser words with one precomputed table lookup
+     *   per non-zero byte.
+     */
+    template <int W>
+    StateSet<W> GetImage(const StateSet<W> &states, const int &character) const {
+        assert(W == num_words_);
+
+        StateSet<W> image;
+
+        for (int w = 0; w < W; w++) {
+            uint64_t word = states.GetWord(w);
+
+            if (image_tables_.empty() || PopCount(word) <= SPARSE_WORD_BITS) {
+                while (word != 0) {
+                    int state = w * BITS_PER_WORD + LowestBit(word);
+                    image.UnionWith(&transitions_[
+                        (state * alphabet_size_ + character) * W]);
+                    word &= word - 1;
+                }
+            }
+            else {
+                for (int b = 0; word != 0; b++, word >>= 8) {
+                    if ((word & 0xff) != 0) {
+                        int chunk = w * (BITS_PER_WORD / 8) + b;
+                        image.UnionWith(&image_tables_[
+                            ((chunk * 256 + (word & 0xff)) * alphabet_size_ +
+                            character) * W]);
+                    }
+                }
+            }
+        }
+        return image;
+    }
+
+    /*
+     * Writes the image of states along every character into images[0 ..
+     *   |Sigma|-1] in a single pass over the members of states. Transitions
+     *   and image tables are laid out letter-innermost, so each member (or
+     *   non-zero byte) contributes one contiguous run of |Sigma| sets.
+     */
+    template <int W>
+    void GetImages(const StateSet<W> &states, StateSet<W> *images) const {
+        assert(W == num_words_);
+
+        for (int c = 0; c < alphabet_size_; c++) {
+            images[c] = StateSet<W>();
+        }
+
+        for (int w = 0; w < W; w++) {
+            uint64_t word = states.GetWord(w);
+
+            if (image_tables_.empty() || PopCount(word) <= SPARSE_WORD_BITS) {
+                while (word != 0) {
+                    int state = w * BITS_PER_WORD + LowestBit(word);
+                    UnionRow<W>(&transitions_[state * alphabet_size_ * W], images);
+                    word &= word - 1;
+                }
+            }
+            else {
+                for (int b = 0; word != 0; b++, word >>= 8) {
+                    if ((word & 0xff) != 0) {
+                        int chunk = w * (BITS_PER_WORD / 8) + b;
+                        UnionRow<W>(&image_tables_[
+                            (chunk * 256 + (word & 0xff)) * alphabet_size_ * W],
+                            images);
+                    }
+                }
+            }
+        }
+    }
+
+    template <int W>
+    StateSet<W> GetInitialStates() const {
+        assert(W == num_words_);
+        return StateSet<W>::FromWords(&initial_states_[0]);
+    }
+
+    template <int W>
+    StateSet<W> GetFinalStates() const {
+        assert(W == num_words_);
+        return StateSet<W>::FromWords(&final_states_[0]);
+    }
+
+private:
+
+    static void InsertState(uint64_t *set, const int &state);
+
+    // images[c] |= (c-th set of the |Sigma| sets starting at row)
+    template <int W>
+    void UnionRow(const uint64_t *row, StateSet<W> *images) const {
+        for (int c = 0; c < alphabet_size_; c++) {
+            images[c].UnionWith(&row[c * W]);
+        }
+    }
+
+    int num_states_;
+    int alphabet_size_;
+    int num_words_;
+
+    // transitions_ holds one state set per (state, character) pair, in the
+    //   order state * alphabet_size_ + character
+    std::vector<uint64_t> transitions_;
+    std::vector<uint64_t> initial_states_;
+    std::vector<uint64_t> final_states_;
+
+    // image_tables_ holds, for every 8-state chunk (num_chunks_ = ceil(n / 8)
+    //   of them), every one of the 256 subsets of that chunk, and every
+    //   character, the image of that subset along that character, in the
+    //   order (chunk, subset, character). Left empty if it would not fit in
+    //   IMAGE_TABLE_BUDGET bytes.
+    int num_chunks_;
+    std::vector<uint64_t> image_tables_;
+};
@@ -0,0 +1,343 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *   buechi_reader.cpp - zero-copy parser for Buechi automaton input files    *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "buechi_reader.h"
+#include "line_scanner.h"
+
+// ========================================================================== //
+// ====================== MAPPED FILE IMPLEMENTATION ======================== //
+// ========================================================================== //
+
+MappedFile::MappedFile() {
+    data_ = NULL;
+    size_ = 0;
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != NULL && size_ > 0) {
+        munmap((void *) data_, size_);
+    }
+}
+
+bool MappedFile::Open(const char *file_name) {
+
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close(fd);
+        return false;
+    }
+
+    // An empty file cannot be mapped, but is still a (malformed) input
+    size_ = info.st_size;
+    if (size_ == 0) {
+        data_ = "";
+        close(fd);
+        return true;
+    }
+
+    void *data = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        size_ = 0;
+        return false;
+    }
+
+    // The whole file is read front to back exactly once
+    madvise(data, size_, MADV_SEQUENTIAL);
+
+    data_ = (const char *) data;
+    return true;
+}
+
+const char *MappedFile::GetData() const {
+    return data_;
+}
+
+size_t MappedFile::GetSize() const {
+    return size_;
+}
+
+
+// ========================================================================== //
+// ============================ State list scanning ========================= //
+// ========================================================================== //
+
+namespace {
+
+/*
+ * Reads 1-indexed states from [p, end) into states (0-indexed) for as long as
+ *   they are in range; anything after the last such state is ignored.
+ */
+void ScanStateList(const char *p, const char *end, const int &num_states,
+    std::vector<int> &states) {
+
+    int i;
+    while (ScanInt(p, end, i) && i > 0 && i <= num_states) {
+        states.push_back(i - 1);
+    }
+}
+
+} // namespace
+
+
+// ========================================================================== //
+// ============================ Buechi file parser ========================== //
+// ========================================================================== //
+
+bool ParseBuechi(const char *data, const size_t &size,
+    BuchiAutomaton &automaton, int &num_states, std::string &error) {
+
+    // Possible read states we can be in
+    enum ReadState {
+        INVALID,
+        WAIT_FOR_TAG,
+        READ_NUM_STATES,
+        READ_ALPHABET_SIZE,
+        READ_NUM_TRANSITIONS,
+        READ_TRANSITIONS,
+        READ_INITIAL_STATES,
+        READ_FINAL_STATES,
+        DONE
+    };
+
+    // Ensure that all fields start as invalid fields
+    bool found_num_states = false, found_alphabet_size = false,
+         found_initial_states = false, found_transitions = false,
+         found_num_transitions = false, found_final_states = false;
+
+    num_states = -1;
+    int alphabet_size = -1;
+
+    // Parsed (0-indexed) states & transitions, added to the automaton once
+    //   the whole file has been validated
+    std::vector<int> initial_states, final_states, transitions;
+
+    // Running count of the # of transitions we've read
+    int num_transitions = -1;
+    int transition_count = 0;
+
+    ReadState state = WAIT_FOR_TAG;
+    LineScanner lines(data, size);
+    const char *line, *line_end;
+
+    while (state != INVALID && state != DONE) {
+
+        if (!lines.NextLine(line, line_end)) {
+            error = "unexpected end of file after line " +
+                std::to_string(lines.GetLineNumber());
+            return false;
+        }
+
+        const char *p = line;
+
+        switch (state) {
+
+            // WAIT_FOR_TAG:
+            //   If we find a proper tag, switch to corresponding state. Any
+            //   other line is a comment.
+            case (WAIT_FOR_TAG):
+                if (LineEquals(line, line_end, NUM_STATES_TAG)) {
+                    state = (found_num_states ? INVALID : READ_NUM_STATES);
+                }
+                else if (LineEquals(line, line_end, ALPHABET_SIZE_TAG)) {
+                    state = (found_alphabet_size ? INVALID : READ_ALPHABET_SIZE);
+                }
+                else if (LineEquals(line, line_end, NUM_TRANSITIONS_TAG)) {
+                    state = (found_num_transitions ? INVALID : READ_NUM_TRANSITIONS);
+                }
+                else if (LineEquals(line, line_end, BEGIN_TRANSITIONS_TAG)) {
+                    if (!found_transitions && found_num_states &&
+                        found_num_transitions && found_alphabet_size) {
+                        state = READ_TRANSITIONS;
+
+                        // Every transition line takes at least 6 bytes
+                        transitions.reserve(3 * (size_t) std::min(
+                            num_transitions, (int) (size / 6)));
+                    }
+                    else {
+                        error = "transitions must come once, after the numbers "
+                            "of states, letters and transitions";
+                        state = INVALID;
+                    }
+                }
+                else if (LineEquals(line, line_end, INITIAL_STATES_TAG)) {
+                    state = (found_initial_states ? INVALID : READ_INITIAL_STATES);
+                }
+                else if (LineEquals(line, line_end, FINAL_STATES_TAG)) {
+                    state = (found_final_states ? INVALID : READ_FINAL_STATES);
+                }
+                else if (LineEquals(line, line_end, BUECHI_EOF_TAG)) {
+                    if (found_num_states && found_alphabet_size &&
+                        found_initial_states && found_transitions &&
+                        found_num_transitions && found_final_states) {
+                        state = DONE;
+                    }
+                    else {
+                        error = "end of automaton before every section was given";
+                        state = INVALID;
+                    }
+                }
+                else if (LineEquals(line, line_end, END_TRANSITIONS_TAG)) {
+                    error = "end of transitions without a beginning";
+                    state = INVALID;
+                }
+
+                if (state == INVALID && error.empty()) {
+                    error = "section given twice";
+                }
+                break;
+
+            // READ_NUM_STATES:
+            //   Parse a single number, set num_states, wait for new tag
+            case (READ_NUM_STATES):
+                found_num_states = true;
+                if (!ScanInt(p, line_end, num_states)) { num_states = -1; }
+                if (num_states > 0 && StateWordsFor(num_states) > 0) {
+                    state = WAIT_FOR_TAG;
+                }
+                else {
+                    error = "bad number of states";
+                    state = INVALID;
+                }
+                break;
+
+            // READ_ALPHABET_SIZE:
+            //   Parse a single number, set alphabet_size, wait for new tag
+            case (READ_ALPHABET_SIZE):
+                found_alphabet_size = true;
+                if (ScanInt(p, line_end, alphabet_size) && alphabet_size >= 0) {
+                    state = WAIT_FOR_TAG;
+                }
+                else {
+                    error = "bad alphabet size";
+                    state = INVALID;
+                }
+                break;
+
+            // READ_NUM_TRANSITIONS:
+            //   Parse a single number, set num_transitions, wait for new tag
+            case (READ_NUM_TRANSITIONS):
+                found_num_transitions = true;
+                if (ScanInt(p, line_end, num_transitions) && num_transitions > 0) {
+                    state = WAIT_FOR_TAG;
+                }
+                else {
+                    error = "bad number of transitions";
+                    state = INVALID;
+                }
+                break;
+
+            // READ_TRANSITIONS:
+            //   If we reach the end tag, check the # of transitions we've found
+            //     and compare it to the file's num_transitions. Otherwise, read
+            //     three integers and insert a transitions, incrementing the
+            //     running transition count
+            case (READ_TRANSITIONS):
+                if (LineEquals(line, line_end, END_TRANSITIONS_TAG)) {
+                    if (transition_count == num_transitions) {
+                        found_transitions = true;
+                        state = WAIT_FOR_TAG;
+                    }
+                    else {
+                        error = "found " + std::to_string(transition_count) +
+                            " transitions, expected " +
+                            std::to_string(num_transitions);
+                        state = INVALID;
+                    }
+                }
+                else {
+                    int pre_state = -1, character = -1, post_state = -1;
+
+                    if (ScanInt(p, line_end, pre_state) &&
+                        ScanInt(p, line_end, character) &&
+                        ScanInt(p, line_end, post_state) &&
+                        pre_state > 0 && pre_state <= num_states &&
+                        character > 0 && character <= alphabet_size &&
+                        post_state > 0 && post_state <= num_states) {
+                        // Switch from 1-indexing to 0-indexing
+                        transitions.push_back(pre_state - 1);
+                        transitions.push_back(character - 1);
+                        transitions.push_back(post_state - 1);
+                    }
+                    else {
+                        error = "bad transition";
+                        state = INVALID;
+                    }
+                    transition_count++;
+                }
+                break;
+
+            // READ_INITIAL_STATES:
+            //   Add every (in range) state on the line to initial_states
+            case (READ_INITIAL_STATES):
+                if (!found_num_states) {
+                    error = "initial states given before the number of states";
+                    state = INVALID;
+                }
+                else {
+                    ScanStateList(p, line_end, num_states, initial_states);
+                    found_initial_states = true;
+                    state = WAIT_FOR_TAG;
+                }
+                break;
+
+            // READ_FINAL_STATES:
+            //   Add every (in range) state on the line to final_states
+            case (READ_FINAL_STATES):
+                if (!found_num_states) {
+                    error = "final states given before the number of states";
+                    state = INVALID;
+                }
+                else {
+                    ScanStateList(p, line_end, num_states, final_states);
+                    found_final_states = true;
+                    state = WAIT_FOR_TAG;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if (state != DONE) {
+        error = "line " + std::to_string(lines.GetLineNumber()) + ": " + error;
+        return false;
+    }
+
+    automaton = BuchiAutomaton(num_states, alphabet_size);
+    for (size_t i = 0; i < transitions.size(); i += 3) {
+        automaton.AddTransition(transitions[i], transitions[i+1], transitions[i+2]);
+    }
+    for (int i : initial_states) {
+        automaton.AddInitialState(i);
+    }
+    for (int i : final_states) {
+        automaton.AddFinalState(i);
+    }
+    automaton.PrecomputeImages();
+    return true;
+}
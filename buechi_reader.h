@@ -0,0 +1,64 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *     buechi_reader.h - zero-copy parser for Buechi automaton input files    *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "buechi_automaton.h"
+
+// Tag lines of the .aut format (the Rabin output reuses the shared ones)
+#define NUM_STATES_TAG "# Number of states"
+#define ALPHABET_SIZE_TAG "# Alphabet size"
+#define NUM_TRANSITIONS_TAG "# Number of transitions"
+#define BEGIN_TRANSITIONS_TAG "# begin transitions"
+#define END_TRANSITIONS_TAG "# end transitions"
+#define INITIAL_STATES_TAG "# Buechi initial"
+#define FINAL_STATES_TAG "# Buechi final"
+#define BUECHI_EOF_TAG "# Buechi eof"
+
+/*
+ * A read-only view of a whole file. The file is memory-mapped, so its
+ *   contents are never copied into the process; the view stays valid until
+ *   the MappedFile is destroyed.
+ */
+class MappedFile {
+public:
+
+    MappedFile();
+    ~MappedFile();
+
+    // Maps the named file, returning false if it cannot be opened or mapped
+    bool Open(const char *file_name);
+
+    const char *GetData() const;
+    size_t GetSize() const;
+
+private:
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+    const char *data_;
+    size_t size_;
+};
+
+/*
+ * Parses the Buechi automaton file held in data[0 .. size) (format in
+ *   info.txt) into automaton. The text is tokenized in place, one line at a
+ *   time, with no per-line allocation and no limit on line length.
+ *
+ * Returns true if the text describes a full, valid Buechi automaton.
+ *   Otherwise returns false and sets error to a message naming the offending
+ *   line. num_states is set as soon as it is read, so callers can report
+ *   automata that are too large.
+ */
+bool ParseBuechi(const char *data, const size_t &size,
+    BuchiAutomaton &automaton, int &num_states, std::string &error);
@@ -0,0 +1,1032 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *       hoa_reader.cpp - parser for Buechi automata in the HOA format        *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+
+#include "hoa_reader.h"
+
+// Aliases may refer to other aliases, but not more deeply than this (which
+//   also stops an alias that refers to itself)
+#define MAX_HOA_ALIAS_DEPTH 64
+
+// ========================================================================== //
+// ================================ Tokens ================================== //
+// ========================================================================== //
+
+namespace {
+
+enum HoaTokenType {
+    TOKEN_EOF,
+    TOKEN_HEADER,           // "name:", text without the ':'
+    TOKEN_IDENTIFIER,       // t, f, Inf, v1, ...
+    TOKEN_INT,
+    TOKEN_STRING,           // text without the quotes, still escaped
+    TOKEN_ALIAS,            // "@name", text without the '@'
+    TOKEN_PUNCTUATION,      // one of ! & | ( ) { } [ ]
+    TOKEN_BODY,             // --BODY--
+    TOKEN_END,              // --END--
+    TOKEN_ABORT,            // --ABORT--
+    TOKEN_INVALID
+};
+
+struct HoaToken {
+    HoaTokenType type;
+    const char *begin;
+    const char *end;
+    long long value;        // of a TOKEN_INT
+    int line;
+};
+
+bool IsIdentifierStart(const char &c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool IsIdentifierChar(const char &c) {
+    return IsIdentifierStart(c) || (c >= '0' && c <= '9') || c == '-';
+}
+
+/*
+ * Splits the text into HOA tokens, in place: a token is a range of the text,
+ *   so reading one never allocates. Blanks & (nested) comments are skipped.
+ */
+class HoaLexer {
+public:
+
+    HoaLexer(const char *data, const size_t &size) {
+        p_ = data;
+        end_ = data + size;
+        line_ = 1;
+        Next();
+    }
+
+    const HoaToken &Peek() const {
+        return token_;
+    }
+
+    bool IsPunctuation(const char &c) const {
+        return token_.type == TOKEN_PUNCTUATION && *token_.begin == c;
+    }
+
+    bool IsHeader(const char *name) const {
+        size_t length = strlen(name);
+        return token_.type == TOKEN_HEADER &&
+            (size_t) (token_.end - token_.begin) == length &&
+            memcmp(token_.begin, name, length) == 0;
+    }
+
+    bool IsIdentifier(const char *name) const {
+        size_t length = strlen(name);
+        return token_.type == TOKEN_IDENTIFIER &&
+            (size_t) (token_.end - token_.begin) == length &&
+            memcmp(token_.begin, name, length) == 0;
+    }
+
+    // Moves to the next token
+    void Next() {
+        SkipBlanksAndComments();
+
+        token_.begin = p_;
+        token_.end = p_;
+        token_.value = 0;
+        token_.line = line_;
+
+        if (p_ == end_) {
+            token_.type = TOKEN_EOF;
+            return;
+        }
+
+        char c = *p_;
+
+        if (IsIdentifierStart(c)) {
+            while (p_ != end_ && IsIdentifierChar(*p_)) {
+                p_++;
+            }
+            token_.end = p_;
+            token_.type = TOKEN_IDENTIFIER;
+            if (p_ != end_ && *p_ == ':') {
+                token_.type = TOKEN_HEADER;
+                p_++;
+            }
+        }
+        else if (c >= '0' && c <= '9') {
+            long long value = 0;
+            token_.type = TOKEN_INT;
+            while (p_ != end_ && *p_ >= '0' && *p_ <= '9') {
+                if (value <= INT_MAX) {
+                    value = value * 10 + (*p_ - '0');
+                }
+                p_++;
+            }
+            if (value > INT_MAX) {
+                token_.type = TOKEN_INVALID;
+            }
+            token_.end = p_;
+            token_.value = value;
+        }
+        else if (c == '"') {
+            p_++;
+            token_.begin = p_;
+            while (p_ != end_ && *p_ != '"') {
+                if (*p_ == '\\' && p_ + 1 != end_) { p_++; }
+                if (*p_ == '\n') { line_++; }
+                p_++;
+            }
+            token_.end = p_;
+            token_.type = (p_ == end_ ? TOKEN_INVALID : TOKEN_STRING);
+            if (p_ != end_) { p_++; }
+        }
+        else if (c == '@') {
+            p_++;
+            token_.begin = p_;
+            while (p_ != end_ && IsIdentifierChar(*p_)) {
+                p_++;
+            }
+            token_.end = p_;
+            token_.type = (token_.begin == p_ ? TOKEN_INVALID : TOKEN_ALIAS);
+        }
+        else if (strchr("!&|(){}[]", c) != NULL) {
+            p_++;
+            token_.end = p_;
+            token_.type = TOKEN_PUNCTUATION;
+        }
+        else if (SkipWord("--BODY--")) {
+            token_.type = TOKEN_BODY;
+        }
+        else if (SkipWord("--END--")) {
+            token_.type = TOKEN_END;
+        }
+        else if (SkipWord("--ABORT--")) {
+            token_.type = TOKEN_ABORT;
+        }
+        else {
+            p_++;
+            token_.type = TOKEN_INVALID;
+        }
+    }
+
+    // Where the next token starts (the current one ends before it)
+    const char *GetPosition() const {
+        return p_;
+    }
+
+private:
+
+    bool SkipWord(const char *word) {
+        size_t length = strlen(word);
+        if ((size_t) (end_ - p_) < length || memcmp(p_, word, length) != 0) {
+            return false;
+        }
+        p_ += length;
+        token_.end = p_;
+        return true;
+    }
+
+    void SkipBlanksAndComments() {
+        while (p_ != end_) {
+            if (*p_ == '\n') {
+                line_++;
+                p_++;
+            }
+            else if (*p_ == ' ' || *p_ == '\t' || *p_ == '\r') {
+                p_++;
+            }
+            else if (*p_ == '/' && p_ + 1 != end_ && p_[1] == '*') {
+                int depth = 0;
+                while (p_ != end_) {
+                    if (*p_ == '/' && p_ + 1 != end_ && p_[1] == '*') {
+                        depth++;
+                        p_ += 2;
+                    }
+                    else if (*p_ == '*' && p_ + 1 != end_ && p_[1] == '/') {
+                        p_ += 2;
+                        if (--depth == 0) { break; }
+                    }
+                    else {
+                        if (*p_ == '\n') { line_++; }
+                        p_++;
+                    }
+                }
+            }
+            else {
+                return;
+            }
+        }
+    }
+
+    const char *p_;
+    const char *end_;
+    int line_;
+    HoaToken token_;
+};
+
+// The text of a string token, with its escapes resolved
+std::string Unescape(const HoaToken &token) {
+    std::string text;
+    for (const char *c = token.begin; c != token.end; c++) {
+        if (*c == '\\' && c + 1 != token.end) { c++; }
+        text += *c;
+    }
+    return text;
+}
+
+
+// ========================================================================== //
+// ================================ Parser ================================== //
+// ========================================================================== //
+
+// An edge of the HOA automaton. label >= 0 is an index into the parser's
+//   label letter sets; an implicitly labelled edge has label -1 - letter.
+struct HoaEdge {
+    int source;
+    int label;
+    int target;
+    uint64_t acceptance_sets;
+};
+
+/*
+ * Reads the header & the body of one automaton, then builds the Buechi
+ *   automaton. A letter set is a bitvector over the 2^|AP| letters
+ *   (num_letter_words_ words), so a label is evaluated for every letter at
+ *   once: proposition i is a fixed bit pattern, and !, & and | are bitwise
+ *   NOT, AND and OR over the words.
+ */
+class HoaParser {
+public:
+
+    HoaParser(const char *data, const size_t &size)
+        : lexer_(data, size) {
+        text_end_ = data + size;
+        num_states_ = -1;
+        num_aps_ = 0;
+        num_acceptance_sets_ = 0;
+        inf_sets_ = 0;
+        accept_nothing_ = false;
+        found_acceptance_ = false;
+        num_letter_words_ = 1;
+    }
+
+    bool Parse(BuchiAutomaton &automaton, int &num_states,
+        std::vector<std::string> &atomic_propositions, std::string &error);
+
+private:
+
+    bool ParseHeader();
+    bool ParseAcceptance(bool &accept_nothing);
+    bool ParseBody();
+    bool ParseStateId(int &state);
+    bool ParseAcceptanceSets(uint64_t &sets);
+    bool ParseLabel(int &label);
+
+    bool ParseOr(HoaLexer &lexer, std::vector<uint64_t> &letters,
+        const int &depth);
+    bool ParseAnd(HoaLexer &lexer, std::vector<uint64_t> &letters,
+        const int &depth);
+    bool ParseNot(HoaLexer &lexer, std::vector<uint64_t> &letters,
+        const int &depth);
+    void PropositionLetters(const int &ap, std::vector<uint64_t> &letters);
+    void ClearUnusedLetters(std::vector<uint64_t> &letters);
+
+    bool Build(BuchiAutomaton &automaton, int &num_states);
+
+    bool Fail(const std::string &message) {
+        if (error_.empty()) {
+            error_ = "line " + std::to_string(lexer_.Peek().line) + ": " +
+                message;
+        }
+        return false;
+    }
+
+    HoaLexer lexer_;
+    std::string error_;
+
+    // From the header
+    int num_states_;                // -1 if there is no States: header
+    std::vector<int> initial_states_;
+    int num_aps_;
+    std::vector<std::string> aps_;
+    int num_acceptance_sets_;
+    uint64_t inf_sets_;             // the sets of the Inf(i) conjunction
+    bool accept_nothing_;           // the condition is f
+    bool found_acceptance_;
+
+    // Aliases, by name, as the position of their expression in the text
+    std::map<std::string, const char *> aliases_;
+    const char *text_end_;
+
+    // From the body: edges in file order, every state's acceptance sets
+    //   (& whether it has been declared), and the letter sets of the
+    //   distinct labels, keyed by their text
+    std::vector<HoaEdge> edges_;
+    std::vector<uint64_t> state_sets_;
+    std::vector<bool> declared_;
+    int max_state_;
+
+    int num_letter_words_;
+    std::vector<uint64_t> label_letters_;
+    std::unordered_map<std::string, int> label_ids_;
+};
+
+
+// ============================== The header ================================ //
+
+bool HoaParser::ParseHeader() {
+
+    if (!lexer_.IsHeader("HOA")) {
+        return Fail("a HOA file starts with \"HOA:\"");
+    }
+    lexer_.Next();
+    if (!lexer_.IsIdentifier("v1")) {
+        return Fail("only version v1 of the format is supported");
+    }
+    lexer_.Next();
+
+    while (lexer_.Peek().type != TOKEN_BODY) {
+        const HoaToken &token = lexer_.Peek();
+
+        if (token.type != TOKEN_HEADER) {
+            return Fail(token.type == TOKEN_EOF ? "no --BODY--" :
+                "expected a header item");
+        }
+
+        if (lexer_.IsHeader("States")) {
+            lexer_.Next();
+            if (lexer_.Peek().type != TOKEN_INT || num_states_ >= 0) {
+                return Fail("bad or repeated States:");
+            }
+            num_states_ = lexer_.Peek().value;
+            lexer_.Next();
+        }
+        else if (lexer_.IsHeader("Start")) {
+            lexer_.Next();
+            int state;
+            if (!ParseStateId(state)) {
+                return false;
+            }
+            if (lexer_.IsPunctuation('&')) {
+                return Fail("alternating automata are not supported");
+            }
+            initial_states_.push_back(state);
+        }
+        else if (lexer_.IsHeader("AP")) {
+            lexer_.Next();
+            if (lexer_.Peek().type != TOKEN_INT || !aps_.empty()) {
+                return Fail("bad or repeated AP:");
+            }
+            num_aps_ = lexer_.Peek().value;
+            if (num_aps_ > MAX_HOA_ATOMIC_PROPOSITIONS) {
+                return Fail("more than " +
+                    std::to_string(MAX_HOA_ATOMIC_PROPOSITIONS) +
+                    " atomic propositions are not supported");
+            }
+            lexer_.Next();
+            while (lexer_.Peek().type == TOKEN_STRING) {
+                aps_.push_back(Unescape(lexer_.Peek()));
+                lexer_.Next();
+            }
+            if ((int) aps_.size() != num_aps_) {
+                return Fail("AP: lists " + std::to_string(aps_.size()) +
+                    " propositions, expected " + std::to_string(num_aps_));
+            }
+        }
+        else if (lexer_.IsHeader("Alias")) {
+            lexer_.Next();
+            if (lexer_.Peek().type != TOKEN_ALIAS) {
+                return Fail("bad Alias:");
+            }
+            std::string name(lexer_.Peek().begin, lexer_.Peek().end);
+            aliases_[name] = lexer_.GetPosition();
+
+            // The expression is only evaluated where the alias is used
+            lexer_.Next();
+            while (lexer_.Peek().type != TOKEN_HEADER &&
+                lexer_.Peek().type != TOKEN_BODY &&
+                lexer_.Peek().type != TOKEN_EOF) {
+                lexer_.Next();
+            }
+        }
+        else if (lexer_.IsHeader("Acceptance")) {
+            lexer_.Next();
+            if (lexer_.Peek().type != TOKEN_INT || found_acceptance_ ||
+                lexer_.Peek().value > 64) {
+                return Fail("bad or repeated Acceptance:");
+            }
+            num_acceptance_sets_ = lexer_.Peek().value;
+            lexer_.Next();
+            if (!ParseAcceptance(accept_nothing_)) {
+                return false;
+            }
+            found_acceptance_ = true;
+        }
+        else {
+            // name:, tool:, acc-name:, properties: & any other header item
+            //   do not change the automaton
+            lexer_.Next();
+            while (lexer_.Peek().type != TOKEN_HEADER &&
+                lexer_.Peek().type != TOKEN_BODY &&
+                lexer_.Peek().type != TOKEN_EOF) {
+                lexer_.Next();
+            }
+        }
+    }
+    lexer_.Next();
+
+    if (!found_acceptance_) {
+        return Fail("no Acceptance: before --BODY--");
+    }
+
+    num_letter_words_ = ((1 << num_aps_) + 63) / 64;
+    return true;
+}
+
+/*
+ * Reads a conjunction of t, f, Inf(i) & parenthesized conjunctions into
+ *   inf_sets_ (& accept_nothing, if f is one of its terms)
+ */
+bool HoaParser::ParseAcceptance(bool &accept_nothing) {
+
+    while (true) {
+        if (lexer_.IsIdentifier("t")) {
+            lexer_.Next();
+        }
+        else if (lexer_.IsIdentifier("f")) {
+            accept_nothing = true;
+            lexer_.Next();
+        }
+        else if (lexer_.IsIdentifier("Inf")) {
+            lexer_.Next();
+            if (!lexer_.IsPunctuation('(')) {
+                return Fail("bad Inf(...)");
+            }
+            lexer_.Next();
+            if (lexer_.Peek().type != TOKEN_INT ||
+                lexer_.Peek().value >= num_acceptance_sets_) {
+                return Fail("acceptance set out of range");
+            }
+            inf_sets_ |= uint64_t(1) << lexer_.Peek().value;
+            lexer_.Next();
+            if (!lexer_.IsPunctuation(')')) {
+                return Fail("bad Inf(...)");
+            }
+            lexer_.Next();
+        }
+        else if (lexer_.IsPunctuation('(')) {
+            lexer_.Next();
+            if (!ParseAcceptance(accept_nothing)) {
+                return false;
+            }
+            if (!lexer_.IsPunctuation(')')) {
+                return Fail("unbalanced parentheses in Acceptance:");
+            }
+            lexer_.Next();
+        }
+        else {
+            return Fail("only Buechi & generalized Buechi acceptance (t, f "
+                "or a conjunction of Inf) is supported");
+        }
+
+        if (!lexer_.IsPunctuation('&')) {
+            break;
+        }
+        lexer_.Next();
+    }
+
+    if (lexer_.IsPunctuation('|') || lexer_.IsIdentifier("Fin")) {
+        return Fail("only Buechi & generalized Buechi acceptance (t, f "
+            "or a conjunction of Inf) is supported");
+    }
+    return true;
+}
+
+
+// =============================== The body ================================= //
+
+bool HoaParser::ParseStateId(int &state) {
+    if (lexer_.Peek().type != TOKEN_INT ||
+        (num_states_ >= 0 && lexer_.Peek().value >= num_states_)) {
+        return Fail("bad state number");
+    }
+    if (lexer_.Peek().value >= MAX_BUECHI_STATES) {
+        return Fail("automata with more than " +
+            std::to_string(MAX_BUECHI_STATES) + " states are not supported");
+    }
+    state = lexer_.Peek().value;
+    lexer_.Next();
+    return true;
+}
+
+bool HoaParser::ParseAcceptanceSets(uint64_t &sets) {
+    sets = 0;
+    if (!lexer_.IsPunctuation('{')) {
+        return true;
+    }
+    lexer_.Next();
+
+    while (lexer_.Peek().type == TOKEN_INT) {
+        if (lexer_.Peek().value >= num_acceptance_sets_) {
+            return Fail("acceptance set out of range");
+        }
+        sets |= uint64_t(1) << lexer_.Peek().value;
+        lexer_.Next();
+    }
+
+    if (!lexer_.IsPunctuation('}')) {
+        return Fail("bad acceptance sets");
+    }
+    lexer_.Next();
+    return true;
+}
+
+bool HoaParser::ParseBody() {
+
+    max_state_ = -1;
+    for (int state : initial_states_) {
+        max_state_ = std::max(max_state_, state);
+    }
+
+    while (lexer_.IsHeader("State")) {
+        lexer_.Next();
+
+        // State: [label] id "name" {sets}
+        int state_label = -1;
+        if (lexer_.IsPunctuation('[') && !ParseLabel(state_label)) {
+            return false;
+        }
+
+        int state;
+        if (!ParseStateId(state)) {
+            return false;
+        }
+        max_state_ = std::max(max_state_, state);
+
+        if (lexer_.Peek().type == TOKEN_STRING) {
+            lexer_.Next();
+        }
+
+        uint64_t sets;
+        if (!ParseAcceptanceSets(sets)) {
+            return false;
+        }
+        if ((size_t) state >= state_sets_.size()) {
+            state_sets_.resize(state + 1, 0);
+            declared_.resize(state + 1, false);
+        }
+        if (declared_[state]) {
+            return Fail("state " + std::to_string(state) + " given twice");
+        }
+        declared_[state] = true;
+        state_sets_[state] = sets;
+
+        // Edges: [label] target {sets}, all labelled or all implicit
+        int num_implicit = 0, num_labelled = 0;
+
+        while (lexer_.IsPunctuation('[') || lexer_.Peek().type == TOKEN_INT) {
+            HoaEdge edge;
+            edge.source = state;
+            edge.label = state_label;
+
+            if (lexer_.IsPunctuation('[')) {
+                if (state_label >= 0) {
+                    return Fail("a labelled state cannot have labelled edges");
+                }
+                if (!ParseLabel(edge.label)) {
+                    return false;
+                }
+                num_labelled++;
+            }
+            else if (state_label < 0) {
+                if (num_implicit == (1 << num_aps_)) {
+                    return Fail("more implicitly labelled edges than letters");
+                }
+                edge.label = -1 - num_implicit++;
+            }
+
+            if (!ParseStateId(edge.target)) {
+                return false;
+            }
+            if (lexer_.IsPunctuation('&')) {
+                return Fail("alternating automata are not supported");
+            }
+            max_state_ = std::max(max_state_, edge.target);
+
+            if (!ParseAcceptanceSets(edge.acceptance_sets)) {
+                return false;
+            }
+            edges_.push_back(edge);
+        }
+
+        if (num_implicit > 0 && num_labelled > 0) {
+            return Fail("a state's edges are either all labelled or none are");
+        }
+    }
+
+    if (lexer_.Peek().type == TOKEN_ABORT) {
+        return Fail("the automaton was aborted (--ABORT--)");
+    }
+    if (lexer_.Peek().type != TOKEN_END) {
+        return Fail("expected State: or --END--");
+    }
+    return true;
+}
+
+
+// ================================ Labels ================================== //
+
+/*
+ * Reads a [...] label & sets label to the index of its letter set, which is
+ *   only computed the first time its text is seen
+ */
+bool HoaParser::ParseLabel(int &label) {
+
+    const char *begin = lexer_.GetPosition();
+    lexer_.Next();
+
+    // Find the end of the label without evaluating it
+    while (!lexer_.IsPunctuation(']')) {
+        HoaTokenType type = lexer_.Peek().type;
+        if (type == TOKEN_EOF || type == TOKEN_BODY || type == TOKEN_END) {
+            return Fail("unterminated label");
+        }
+        lexer_.Next();
+    }
+    const char *end = lexer_.Peek().begin;
+    lexer_.Next();
+
+    std::string text(begin, end);
+    auto found = label_ids_.find(text);
+    if (found != label_ids_.end()) {
+        label = found->second;
+        return true;
+    }
+
+    HoaLexer label_lexer(begin, end - begin);
+    std::vector<uint64_t> letters;
+    if (!ParseOr(label_lexer, letters, 0)) {
+        return false;
+    }
+    if (label_lexer.Peek().type != TOKEN_EOF) {
+        return Fail("bad label");
+    }
+
+    label = label_ids_.size();
+    label_ids_[text] = label;
+    label_letters_.insert(label_letters_.end(), letters.begin(), letters.end());
+    return true;
+}
+
+// or := and ('|' and)*
+bool HoaParser::ParseOr(HoaLexer &lexer, std::vector<uint64_t> &letters,
+    const int &depth) {
+
+    if (!ParseAnd(lexer, letters, depth)) {
+        return false;
+    }
+    while (lexer.IsPunctuation('|')) {
+        lexer.Next();
+        std::vector<uint64_t> right;
+        if (!ParseAnd(lexer, right, depth)) {
+            return false;
+        }
+        for (int w = 0; w < num_letter_words_; w++) {
+            letters[w] |= right[w];
+        }
+    }
+    return true;
+}
+
+// and := not ('&' not)*
+bool HoaParser::ParseAnd(HoaLexer &lexer, std::vector<uint64_t> &letters,
+    const int &depth) {
+
+    if (!ParseNot(lexer, letters, depth)) {
+        return false;
+    }
+    while (lexer.IsPunctuation('&')) {
+        lexer.Next();
+        std::vector<uint64_t> right;
+        if (!ParseNot(lexer, right, depth)) {
+            return false;
+        }
+        for (int w = 0; w < num_letter_words_; w++) {
+            letters[w] &= right[w];
+        }
+    }
+    return true;
+}
+
+// not := '!' not | 't' | 'f' | proposition | @alias | '(' or ')'
+bool HoaParser::ParseNot(HoaLexer &lexer, std::vector<uint64_t> &letters,
+    const int &depth) {
+
+    const HoaToken &token = lexer.Peek();
+
+    if (lexer.IsPunctuation('!')) {
+        lexer.Next();
+        if (!ParseNot(lexer, letters, depth)) {
+            return false;
+        }
+        for (int w = 0; w < num_letter_words_; w++) {
+            letters[w] = ~letters[w];
+        }
+        ClearUnusedLetters(letters);
+    }
+    else if (lexer.IsIdentifier("t") || lexer.IsIdentifier("f")) {
+        letters.assign(num_letter_words_, lexer.IsIdentifier("t") ? ~0ULL : 0);
+        ClearUnusedLetters(letters);
+        lexer.Next();
+    }
+    else if (token.type == TOKEN_INT) {
+        if (token.value >= num_aps_) {
+            return Fail("atomic proposition out of range");
+        }
+        PropositionLetters(token.value, letters);
+        lexer.Next();
+    }
+    else if (token.type == TOKEN_ALIAS) {
+        auto alias = aliases_.find(std::string(token.begin, token.end));
+        if (alias == aliases_.end()) {
+            return Fail("undefined alias @" +
+                std::string(token.begin, token.end));
+        }
+        if (depth == MAX_HOA_ALIAS_DEPTH) {
+            return Fail("aliases nested too deeply");
+        }
+
+        // The alias's expression runs up to the next header item
+        HoaLexer alias_lexer(alias->second, text_end_ - alias->second);
+        if (!ParseOr(alias_lexer, letters, depth + 1)) {
+            return false;
+        }
+        if (alias_lexer.Peek().type != TOKEN_HEADER &&
+            alias_lexer.Peek().type != TOKEN_BODY) {
+            return Fail("bad alias @" + std::string(token.begin, token.end));
+        }
+        lexer.Next();
+    }
+    else if (lexer.IsPunctuation('(')) {
+        lexer.Next();
+        if (!ParseOr(lexer, letters, depth)) {
+            return false;
+        }
+        if (!lexer.IsPunctuation(')')) {
+            return Fail("unbalanced parentheses in label");
+        }
+        lexer.Next();
+    }
+    else {
+        return Fail("bad label");
+    }
+    return true;
+}
+
+/*
+ * The letters in which proposition ap holds: bit ap of the letter's index.
+ *   Within a word that is a fixed pattern for ap < 6; beyond, whole words
+ *   alternate in runs of 2^(ap - 6).
+ */
+void HoaParser::PropositionLetters(const int &ap,
+    std::vector<uint64_t> &letters) {
+
+    static const uint64_t patterns[6] = {
+        0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+        0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL
+    };
+
+    letters.resize(num_letter_words_);
+    for (int w = 0; w < num_letter_words_; w++) {
+        if (ap < 6) {
+            letters[w] = patterns[ap];
+        }
+        else {
+            letters[w] = ((w >> (ap - 6)) & 1) ? ~0ULL : 0;
+        }
+    }
+    ClearUnusedLetters(letters);
+}
+
+// Clears the bits past the last letter (with fewer than 64 letters)
+void HoaParser::ClearUnusedLetters(std::vector<uint64_t> &letters) {
+    if (num_aps_ < 6) {
+        letters[0] &= (uint64_t(1) << (1 << num_aps_)) - 1;
+    }
+}
+
+
+// ======================== Building the automaton ========================== //
+
+/*
+ * A state-based Buechi (or t / f) condition maps every HOA state to one
+ *   Buechi state. Otherwise the Buechi states are the reachable triples
+ *   (q, i, accepting): i is the index of the next Inf set to visit, edges
+ *   leaving q carry q's sets as well as their own, an edge moves i past every
+ *   set it carries in order, and an edge that gets past the last set starts
+ *   over at 0 & leads to an accepting triple.
+ */
+bool HoaParser::Build(BuchiAutomaton &automaton, int &num_states) {
+
+    int num_hoa_states = (num_states_ >= 0 ? num_states_ : max_state_ + 1);
+    if (num_hoa_states <= 0 || initial_states_.empty()) {
+        error_ = "the automaton has no states or no initial state";
+        return false;
+    }
+    if (max_state_ >= num_hoa_states) {
+        error_ = "state " + std::to_string(max_state_) + " is out of range";
+        return false;
+    }
+    state_sets_.resize(num_hoa_states, 0);
+
+    int alphabet_size = 1 << num_aps_;
+
+    std::vector<int> required;
+    for (int i = 0; i < 64; i++) {
+        if ((inf_sets_ >> i) & 1) { required.push_back(i); }
+    }
+
+    bool edge_sets = false;
+    for (const HoaEdge &edge : edges_) {
+        if (edge.acceptance_sets & inf_sets_) { edge_sets = true; }
+    }
+
+    // Adds a transition from source to target along every letter of edge
+    auto add_transitions = [&](const HoaEdge &edge, const int &source,
+        const int &target, BuchiAutomaton *buechi) {
+        if (edge.label < 0) {
+            buechi->AddTransition(source, -1 - edge.label, target);
+            return;
+        }
+        const uint64_t *letters =
+            &label_letters_[(size_t) edge.label * num_letter_words_];
+        for (int w = 0; w < num_letter_words_; w++) {
+            uint64_t word = letters[w];
+            while (word != 0) {
+                buechi->AddTransition(source, w * 64 + LowestBit(word), target);
+                word &= word - 1;
+            }
+        }
+    };
+
+    if (accept_nothing_ || required.size() == 0 ||
+        (required.size() == 1 && !edge_sets)) {
+
+        num_states = num_hoa_states;
+        if (StateWordsFor(num_states) < 0) {
+            error_ = "too many states";
+            return false;
+        }
+
+        automaton = BuchiAutomaton(num_states, alphabet_size);
+        for (const HoaEdge &edge : edges_) {
+            add_transitions(edge, edge.source, edge.target, &automaton);
+        }
+        for (int state : initial_states_) {
+            automaton.AddInitialState(state);
+        }
+        for (int state = 0; state < num_states; state++) {
+            if (!accept_nothing_ &&
+                (required.empty() || (state_sets_[state] & inf_sets_))) {
+                automaton.AddFinalState(state);
+            }
+        }
+        automaton.PrecomputeImages();
+        return true;
+    }
+
+    // The edges of each HOA state, contiguous (edges_ is in file order)
+    std::vector<int> first_edge(num_hoa_states + 1, 0);
+    for (const HoaEdge &edge : edges_) {
+        first_edge[edge.source + 1]++;
+    }
+    for (int q = 0; q < num_hoa_states; q++) {
+        first_edge[q + 1] += first_edge[q];
+    }
+    std::vector<int> order(edges_.size());
+    std::vector<int> next_edge(first_edge.begin(), first_edge.end() - 1);
+    for (size_t e = 0; e < edges_.size(); e++) {
+        order[next_edge[edges_[e].source]++] = e;
+    }
+
+    // Number the reachable triples in BFS order: triple (q, i, accepting)
+    //   has index (q * |required| + i) * 2 + accepting
+    int num_levels = required.size();
+    std::vector<int> ids((size_t) num_hoa_states * num_levels * 2, -1);
+    std::vector<int> triples;
+    std::vector<int> transitions;
+
+    auto number = [&](const int &triple) {
+        if (ids[triple] < 0) {
+            ids[triple] = triples.size();
+            triples.push_back(triple);
+        }
+        return ids[triple];
+    };
+
+    for (int state : initial_states_) {
+        number(state * num_levels * 2);
+    }
+
+    for (size_t t = 0; t < triples.size(); t++) {
+        if ((int) triples.size() > MAX_BUECHI_STATES) {
+            break;
+        }
+        int q = triples[t] / (num_levels * 2);
+        int level = (triples[t] / 2) % num_levels;
+
+        for (int e = first_edge[q]; e < first_edge[q + 1]; e++) {
+            const HoaEdge &edge = edges_[order[e]];
+            uint64_t sets = edge.acceptance_sets | state_sets_[q];
+
+            int next = level;
+            while (next < num_levels && ((sets >> required[next]) & 1)) {
+                next++;
+            }
+            int accepting = (next == num_levels);
+            if (accepting) { next = 0; }
+
+            transitions.push_back(t);
+            transitions.push_back(order[e]);
+            transitions.push_back(
+                number((edge.target * num_levels + next) * 2 + accepting));
+        }
+    }
+
+    num_states = triples.size();
+    if (StateWordsFor(num_states) < 0) {
+        error_ = "too many states after degeneralization";
+        return false;
+    }
+
+    automaton = BuchiAutomaton(num_states, alphabet_size);
+    for (size_t i = 0; i < transitions.size(); i += 3) {
+        add_transitions(edges_[transitions[i+1]], transitions[i],
+            transitions[i+2], &automaton);
+    }
+    for (int state : initial_states_) {
+        automaton.AddInitialState(ids[state * num_levels * 2]);
+    }
+    for (int state = 0; state < num_states; state++) {
+        if (triples[state] % 2 == 1) {
+            automaton.AddFinalState(state);
+        }
+    }
+    automaton.PrecomputeImages();
+    return true;
+}
+
+bool HoaParser::Parse(BuchiAutomaton &automaton, int &num_states,
+    std::vector<std::string> &atomic_propositions, std::string &error) {
+
+    if (!ParseHeader()) {
+        error = error_;
+        return false;
+    }
+
+    // Reported even if the automaton is too large to be read
+    if (num_states_ > MAX_BUECHI_STATES) {
+        num_states = num_states_;
+        error = "too many states";
+        return false;
+    }
+
+    if (!ParseBody()) {
+        error = error_;
+        return false;
+    }
+    if (!Build(automaton, num_states)) {
+        error = error_;
+        return false;
+    }
+    atomic_propositions = aps_;
+    return true;
+}
+
+} // namespace
+
+
+// ========================================================================== //
+// ============================== HOA parser ================================ //
+// ========================================================================== //
+
+bool IsHoa(const char *data, const size_t &size) {
+    HoaLexer lexer(data, size);
+    return lexer.IsHeader("HOA");
+}
+
+bool ParseHoa(const char *data, const size_t &size, BuchiAutomaton &automaton,
+    int &num_states, std::vector<std::string> &atomic_propositions,
+    std::string &error) {
+
+    num_states = -1;
+    HoaParser parser(data, size);
+    return parser.Parse(automaton, num_states, atomic_propositions, error);
+}
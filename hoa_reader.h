@@ -0,0 +1,51 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *        hoa_reader.h - parser for Buechi automata in the HOA format         *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "buechi_automaton.h"
+
+// Largest number of atomic propositions accepted (the alphabet has 2^|AP|
+//   letters, each of which costs every Safra tree one successor)
+#define MAX_HOA_ATOMIC_PROPOSITIONS 12
+
+// Whether data[0 .. size) starts like a HOA file ("HOA:" after any blanks &
+//   comments)
+bool IsHoa(const char *data, const size_t &size);
+
+/*
+ * Parses the first automaton of the HOA file held in data[0 .. size) into
+ *   automaton. The text is tokenized in place; the only allocations are for
+ *   the parsed edges and one letter set per distinct edge label.
+ *
+ * The alphabet is the set of valuations of the atomic propositions, which
+ *   are returned in atomic_propositions: letter c is the valuation in which
+ *   proposition i holds iff bit i of c is set (HOA's order of implicit
+ *   labels), and a symbolic label [...] becomes every letter that satisfies
+ *   it.
+ *
+ * The acceptance condition has to be Buechi or generalized Buechi (t, f, or a
+ *   conjunction of Inf(i)), with the acceptance sets on states or on edges.
+ *   Anything but a state-based Buechi (or t / f) condition is degeneralized:
+ *   the Buechi states are the reachable (state, next set to visit, whether
+ *   the last edge completed a round) triples.
+ *
+ * Returns false, with a description in error, if the file is not a HOA file
+ *   of such an automaton (alternating automata, Fin, aliases that are never
+ *   defined, ...). num_states is set to the number of Buechi states as soon
+ *   as it is known, so callers can report automata that are too large.
+ */
+bool ParseHoa(const char *data, const size_t &size, BuchiAutomaton &automaton,
+    int &num_states, std::vector<std::string> &atomic_propositions,
+    std::string &error);
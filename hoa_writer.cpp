@@ -0,0 +1,163 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *        hoa_writer.cpp - writes a Rabin automaton in the HOA format         *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include <cassert>
+
+#include "hoa_writer.h"
+
+/*
+ * Writes text as a HOA string: quoted, with '"' & '\' escaped
+ */
+static void WriteHoaString(OutputBuffer &out, const std::string &text) {
+    out.WriteChar('"');
+    for (char c : text) {
+        if (c == '"' || c == '\\') { out.WriteChar('\\'); }
+        out.WriteChar(c);
+    }
+    out.WriteChar('"');
+}
+
+std::vector<std::string> DefaultAtomicPropositions(const int &alphabet_size) {
+    std::vector<std::string> names;
+    while ((1 << names.size()) < alphabet_size) {
+        names.push_back("p" + std::to_string(names.size()));
+    }
+    return names;
+}
+
+/*
+ * The header, the states (with their acceptance sets & trees) & their edges
+ *   are streamed in state order, like WriteRabin. Explicit labels are built
+ *   once per letter.
+ */
+template <int W>
+void WriteRabinHoa(OutputBuffer &out,
+    const char *input_file_name,
+    const RabinAutomaton &rabin,
+    const std::vector<std::string> &atomic_propositions,
+    SafraExplorer<W> &explorer,
+    const std::vector<int> *tree_states,
+    bool with_trees) {
+
+    int num_states = rabin.GetNumStates();
+    int alphabet_size = rabin.GetAlphabetSize();
+    int num_aps = atomic_propositions.size();
+
+    assert((1 << num_aps) >= alphabet_size);
+    bool implicit_labels = ((1 << num_aps) == alphabet_size);
+
+    // Only the pairs whose right side is not empty, as in WriteRabin
+    std::vector<int> pairs;
+    for (int i = 0; i < rabin.GetNumLabels(); i++) {
+        if (!rabin.IsRightEmpty(i)) {
+            pairs.push_back(i);
+        }
+    }
+
+    // ============================== Header ================================ //
+
+    out.WriteLine("HOA: v1");
+    out.Write("name: ");
+    WriteHoaString(out, std::string("Safra: ") + input_file_name);
+    out.Write("\ntool: \"safra\"\nStates: ");
+    out.WriteInt(num_states);
+    out.Write("\nStart: ");
+    out.WriteInt(rabin.GetInitialState());
+    out.Write("\nAP: ");
+    out.WriteInt(num_aps);
+    for (const std::string &name : atomic_propositions) {
+        out.WriteChar(' ');
+        WriteHoaString(out, name);
+    }
+
+    out.Write("\nacc-name: Rabin ");
+    out.WriteInt(pairs.size());
+    out.Write("\nAcceptance: ");
+    out.WriteInt(2 * pairs.size());
+    if (pairs.empty()) {
+        out.Write(" f");
+    }
+    for (size_t k = 0; k < pairs.size(); k++) {
+        out.Write(k == 0 ? " (Fin(" : " | (Fin(");
+        out.WriteInt(2 * k);
+        out.Write(")&Inf(");
+        out.WriteInt(2 * k + 1);
+        out.Write("))");
+    }
+
+    out.Write("\nproperties: deterministic state-acc ");
+    out.WriteLine(implicit_labels ? "complete implicit-labels" :
+        "trans-labels explicit-labels");
+    out.WriteLine("--BODY--");
+
+    // The label of each letter, if edges are labelled explicitly
+    std::vector<std::string> labels;
+    if (!implicit_labels) {
+        for (int c = 0; c < alphabet_size; c++) {
+            std::string label = "[";
+            for (int i = 0; i < num_aps; i++) {
+                if (i > 0) { label += "&"; }
+                if (((c >> i) & 1) == 0) { label += "!"; }
+                label += std::to_string(i);
+            }
+            labels.push_back((num_aps == 0 ? "[t" : label) + "] ");
+        }
+    }
+
+    // =============================== Body ================================= //
+
+    for (int state = 0; state < num_states; state++) {
+        out.Write("State: ");
+        out.WriteInt(state);
+
+        if (with_trees) {
+            out.Write(" \"", 2);
+            explorer.WriteTree(tree_states != NULL ? (*tree_states)[state] :
+                state, out);
+            out.WriteChar('"');
+        }
+
+        // The sets of the pairs with the state on their left / right side
+        uint64_t bit = uint64_t(1) << (state % 64);
+        bool any = false;
+        for (size_t k = 0; k < pairs.size(); k++) {
+            for (int side = 0; side < 2; side++) {
+                const uint64_t *set = (side == 0 ? rabin.GetLeft(pairs[k]) :
+                    rabin.GetRight(pairs[k]));
+                if (set[state / 64] & bit) {
+                    out.Write(any ? " " : " {");
+                    out.WriteInt(2 * k + side);
+                    any = true;
+                }
+            }
+        }
+        out.Write(any ? "}\n" : "\n");
+
+        const uint32_t *successors = rabin.GetSuccessors(state);
+        for (int c = 0; c < alphabet_size; c++) {
+            if (!implicit_labels) {
+                out.Write(labels[c]);
+            }
+            out.WriteInt(successors[c]);
+            out.WriteChar('\n');
+        }
+    }
+
+    out.WriteLine("--END--");
+}
+
+
+// Explicit instantiations for every supported state set width
+#define INSTANTIATE_WRITE_RABIN_HOA(W) template void WriteRabinHoa<W>(         \
+    OutputBuffer &, const char *, const RabinAutomaton &,                      \
+    const std::vector<std::string> &, SafraExplorer<W> &,                      \
+    const std::vector<int> *, bool);
+SAFRA_FOR_EACH_WIDTH(INSTANTIATE_WRITE_RABIN_HOA)
+#undef INSTANTIATE_WRITE_RABIN_HOA
@@ -0,0 +1,47 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *         hoa_writer.h - writes a Rabin automaton in the HOA format          *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "output_buffer.h"
+#include "rabin_automaton.h"
+#include "safra_explorer.h"
+
+/*
+ * Names for the atomic propositions of an alphabet that did not come with
+ *   any (a .aut file): enough propositions "p0", "p1", ... that letter c
+ *   (0-indexed) is the valuation whose bits spell c
+ */
+std::vector<std::string> DefaultAtomicPropositions(const int &alphabet_size);
+
+/*
+ * Writes rabin to out in the Hanoi Omega-Automata format, with letter c as
+ *   the valuation of atomic_propositions in which proposition i holds iff bit
+ *   i of c is set. Each Rabin pair (L, R) whose R is not empty becomes the
+ *   acceptance sets 2k (L) and 2k+1 (R) and the disjunct Fin(2k) & Inf(2k+1)
+ *   of a state-based Rabin condition.
+ *
+ * If the alphabet is every valuation, edges use HOA's implicit labels (one
+ *   successor per letter, in letter order); otherwise each edge is labelled
+ *   with its letter's valuation. With with_trees, each state is named with
+ *   the Safra tree of explorer's state tree_states[state] (or of state itself
+ *   if tree_states is NULL), as in WriteRabin.
+ */
+template <int W>
+void WriteRabinHoa(OutputBuffer &out,
+    const char *input_file_name,
+    const RabinAutomaton &rabin,
+    const std::vector<std::string> &atomic_propositions,
+    SafraExplorer<W> &explorer,
+    const std::vector<int> *tree_states,
+    bool with_trees);
@@ -0,0 +1,148 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *    lazy_rabin.cpp - Rabin automaton whose states are built on demand       *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include <cassert>
+
+#include "lazy_rabin.h"
+
+template <int W>
+LazyRabin<W>::LazyRabin(const BuchiAutomaton *automaton,
+    bool canonical_labels, const SafraAllocator &allocator)
+    : arena_(2*automaton->GetNumStates(), allocator) {
+
+    automaton_ = automaton;
+
+    // The scratch tree starts out as the initial tree
+    scratch_tree_ = new SafraTree<W>(&arena_, automaton_, canonical_labels);
+    decoded_state_ = AddTree(scratch_tree_);
+}
+
+template <int W>
+LazyRabin<W>::~LazyRabin() {
+
+    // The tree hands its nodes back to arena_, so it goes first
+    delete scratch_tree_;
+}
+
+
+// ============================ Access methods ============================== //
+
+/*
+ * The initial tree is always numbered first
+ */
+template <int W>
+int LazyRabin<W>::GetInitialState() {
+    return 0;
+}
+
+/*
+ * Returns the memoized successor if there is one. Otherwise the successor
+ *   tree is computed from the decoded tree of state & looked up, becoming a
+ *   new state if it has not been reached before.
+ */
+template <int W>
+int LazyRabin<W>::GetSuccessor(const int &state, const int &character) {
+
+    assert(state >= 0 && state < GetNumStates());
+    assert(character >= 0 && character < GetAlphabetSize());
+
+    size_t index = (size_t) state * GetAlphabetSize() + character;
+    if (successors_[index] == UNEXPLORED_STATE) {
+
+        DecodeTree(state);
+        SafraTree<W> transition_tree(&arena_, scratch_tree_, character);
+
+        // AddTree may grow successors_, so store the result afterwards
+        int post_state = AddTree(&transition_tree);
+        successors_[index] = post_state;
+    }
+    return successors_[index];
+}
+
+template <int W>
+const typename LazyRabin<W>::Labels &LazyRabin<W>::GetLeftLabels(
+    const int &state) {
+    return left_labels_[state];
+}
+
+template <int W>
+const typename LazyRabin<W>::Labels &LazyRabin<W>::GetRightLabels(
+    const int &state) {
+    return right_labels_[state];
+}
+
+template <int W>
+int LazyRabin<W>::GetNumStates() {
+    return table_.Size();
+}
+
+template <int W>
+int LazyRabin<W>::GetAlphabetSize() {
+    return automaton_->GetAlphabetSize();
+}
+
+template <int W>
+int LazyRabin<W>::GetNumLabels() {
+    return 2*automaton_->GetNumStates();
+}
+
+template <int W>
+SafraTree<W> *LazyRabin<W>::GetTree(const int &state) {
+    DecodeTree(state);
+    return scratch_tree_;
+}
+
+
+// ========================= Private helper methods ========================= //
+
+/*
+ * Returns the state of tree: a new tree becomes the next state, of which only
+ *   the encoding & the Rabin pair labels are kept
+ */
+template <int W>
+int LazyRabin<W>::AddTree(SafraTree<W> *tree) {
+
+    bool inserted;
+    uint64_t hash = tree->Encode(key_);
+    int state = table_.Insert(&key_[0], key_.size(), hash, inserted);
+
+    if (!inserted) {
+        return state;
+    }
+
+    successors_.resize(successors_.size() + GetAlphabetSize(),
+        UNEXPLORED_STATE);
+
+    // Renamed labels count as unused, as in SafraExplorer
+    left_labels_.push_back(Labels::Union(tree->GetUnusedLabels(),
+        tree->GetRenamedLabels()));
+    right_labels_.push_back(tree->GetMarkedLabels());
+
+    return state;
+}
+
+/*
+ * Decodes the tree of state into the scratch tree, unless it already holds it
+ *   (as when the successors of one state are asked for in a row)
+ */
+template <int W>
+void LazyRabin<W>::DecodeTree(const int &state) {
+
+    if (state != decoded_state_) {
+        scratch_tree_->Decode(table_.GetKey(state), table_.GetKeyLength(state));
+        decoded_state_ = state;
+    }
+}
+
+
+// Explicit instantiations for every supported state set width
+#define INSTANTIATE_LAZY_RABIN(W) template class LazyRabin<W>;
+SAFRA_FOR_EACH_WIDTH(INSTANTIATE_LAZY_RABIN)
+#undef INSTANTIATE_LAZY_RABIN
@@ -0,0 +1,95 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *     lazy_rabin.h - Rabin automaton whose states are built on demand        *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "buechi_automaton.h"
+#include "safra_tree.h"
+#include "tree_table.h"
+
+// Successor that has not been asked for yet
+#define UNEXPLORED_STATE -1
+
+/*
+ * The deterministic Rabin automaton of a Buechi automaton, built one
+ *   transition at a time. A state is only created when a transition that
+ *   reaches it is asked for: its Safra tree is computed & deduplicated in a
+ *   TreeTable, whose encoding of the tree (as in SafraExplorer) is all that
+ *   is kept of it, & the transition is memoized, so each transition is
+ *   computed at most once. A caller exploring a product with this automaton
+ *   therefore only ever builds the Rabin states it actually reaches.
+ *
+ * States are numbered 0, 1, 2, ... in the order they are first reached, with
+ *   the initial tree as state 0. One Rabin pair (L, R) exists per Safra node
+ *   label, as in the output of SafraExplorer: a state is in L of every label
+ *   in GetLeftLabels(state) and in R of every label in GetRightLabels(state).
+ *
+ * A LazyRabin is not thread-safe; every thread should use its own.
+ */
+template <int W>
+class LazyRabin {
+public:
+
+    typedef typename SafraTree<W>::Labels Labels;
+
+    // With canonical_labels, label-isomorphic trees are one state if the same
+    //   nodes were just renamed (see SafraTree::CanonicalizeLabels). Node
+    //   arrays come from allocator.
+    LazyRabin(const BuchiAutomaton *automaton, bool canonical_labels,
+        const SafraAllocator &allocator);
+    ~LazyRabin();
+
+    int GetInitialState();
+
+    // Returns the successor of state along character, building it on first use
+    int GetSuccessor(const int &state, const int &character);
+
+    // Labels whose Rabin pair has state on its left / right side
+    const Labels &GetLeftLabels(const int &state);
+    const Labels &GetRightLabels(const int &state);
+
+    // Number of states built so far
+    int GetNumStates();
+    int GetAlphabetSize();
+    int GetNumLabels();
+
+    // Decodes the tree of state. The tree is only valid until the next call to
+    //   GetTree or GetSuccessor.
+    SafraTree<W> *GetTree(const int &state);
+
+private:
+    LazyRabin(const LazyRabin &);
+    LazyRabin &operator=(const LazyRabin &);
+
+    int AddTree(SafraTree<W> *tree);
+    void DecodeTree(const int &state);
+
+    const BuchiAutomaton *automaton_;
+    SafraArena<W> arena_;
+
+    // The state of a tree is its id in table_, which holds its encoding
+    TreeTable table_;
+
+    // Scratch buffer for tree encodings, & the tree states are decoded into
+    //   (decoded_state_ is the state it holds)
+    std::vector<uint8_t> key_;
+    SafraTree<W> *scratch_tree_;
+    int decoded_state_;
+
+    // The memoized transitions: successors_[state * |Sigma| + c] is
+    //   UNEXPLORED_STATE until it is first asked for
+    std::vector<int> successors_;
+
+    std::vector<Labels> left_labels_;
+    std::vector<Labels> right_labels_;
+};
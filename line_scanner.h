@@ -0,0 +1,112 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *     line_scanner.h - line & integer scanning shared by the text parsers    *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <cstring>
+
+/*
+ * A cursor over the lines of the input. Lines are handed out as [begin, end)
+ *   ranges into the mapped text, without their '\n' (or "\r\n") terminator.
+ */
+class LineScanner {
+public:
+
+    LineScanner(const char *data, const size_t &size) {
+        next_ = data;
+        end_ = data + size;
+        line_number_ = 0;
+    }
+
+    // Moves to the next line, returning false at the end of the input
+    bool NextLine(const char *&begin, const char *&end) {
+        if (next_ == end_) {
+            return false;
+        }
+
+        begin = next_;
+        const char *newline = (const char *) memchr(next_, '\n', end_ - next_);
+        end = (newline == NULL ? end_ : newline);
+        next_ = (newline == NULL ? end_ : newline + 1);
+
+        if (end != begin && end[-1] == '\r') {
+            end--;
+        }
+
+        line_number_++;
+        return true;
+    }
+
+    int GetLineNumber() const {
+        return line_number_;
+    }
+
+private:
+    const char *next_;
+    const char *end_;
+    int line_number_;
+};
+
+inline bool LineEquals(const char *begin, const char *end, const char *tag) {
+    size_t length = strlen(tag);
+    return (size_t) (end - begin) == length && memcmp(begin, tag, length) == 0;
+}
+
+/*
+ * Reads one integer from [p, end), skipping leading blanks, and advances p
+ *   past it. Returns false (leaving p untouched) if no integer is next or it
+ *   does not fit in a long long.
+ */
+inline bool ScanInt(const char *&p, const char *end, long long &value) {
+
+    const char *c = p;
+    while (c != end && (*c == ' ' || *c == '\t')) {
+        c++;
+    }
+
+    bool negative = false;
+    if (c != end && (*c == '-' || *c == '+')) {
+        negative = (*c == '-');
+        c++;
+    }
+
+    if (c == end || *c < '0' || *c > '9') {
+        return false;
+    }
+
+    long long result = 0;
+    while (c != end && *c >= '0' && *c <= '9') {
+        if (result > (LLONG_MAX - (*c - '0')) / 10) {
+            return false;
+        }
+        result = result * 10 + (*c - '0');
+        c++;
+    }
+
+    value = (negative ? -result : result);
+    p = c;
+    return true;
+}
+
+// Same, for integers that have to fit in an int
+inline bool ScanInt(const char *&p, const char *end, int &value) {
+
+    const char *c = p;
+    long long result;
+    if (!ScanInt(c, end, result) || result > INT_MAX || result < -INT_MAX) {
+        return false;
+    }
+
+    value = (int) result;
+    p = c;
+    return true;
+}
@@ -9,6 +9,18 @@
  * ************************************************************************** */
 
 #include "safra_tree.h"
+#include "tree_table.h"
+#include "buechi_automaton.h"
+#include "safra_explorer.h"
+#include "buechi_reader.h"
+#include "rabin_automaton.h"
+#include "rabin_writer.h"
+#include "rabin_binary.h"
+#include "hoa_reader.h"
+#include "hoa_writer.h"
+#include "rabin_minimizer.h"
+#include "batch_runner.h"
+#include "spill_explorer.h"
 
 #include <iostream>
 #include <sstream>
@@ -18,537 +30,611 @@
 #include <map>
 #include <iomanip>
 
+#include <chrono>
+#include <cstdio>
+
 #include <string.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+// ========================================================================== //
+// ======= Part 2 : Running Safra's algorithm to get Rabin automaton ======== //
+// ========================================================================== //
 
-// Definitions & constants for I/O purposes
-#define BUFFER_SIZE 100
+/*
+ * Runs Safra's algorithm on the provided Buechi automaton, exploring the Safra
+ *   trees with explorer, and returns the resulting Rabin automaton. The Rabin
+ *   pairs are filled in, as states are numbered, from the label masks each
+ *   tree's expansion recorded, so no separate pass over the trees is needed.
+ *   Afterwards explorer.WriteTree(id, ...) writes the tree that was assigned
+ *   Rabin state id.
+ */
+template <int W>
+const RabinAutomaton &RunSafra(SafraExplorer<W> &explorer) {
 
-#define NUM_STATES_TAG "# Number of states"
-#define ALPHABET_SIZE_TAG "# Alphabet size"
-#define NUM_TRANSITIONS_TAG "# Number of transitions"
-#define BEGIN_TRANSITIONS_TAG "# begin transitions"
-#define END_TRANSITIONS_TAG "# end transitions"
-#define INITIAL_STATES_TAG "# Buechi initial"
-#define FINAL_STATES_TAG "# Buechi final"
-#define BUECHI_EOF_TAG "# Buechi eof"
+    // Compute every reachable tree, the transitions between them & the pairs
+    explorer.Run();
 
-#define RABIN_INFILE_TAG "# Buechi filename"
-#define RABIN_INITIAL_STATE_TAG "# Rabin initial"
-#define BEGIN_RABIN_PAIRS_TAG "# begin Rabin pairs"
-#define END_RABIN_PAIRS_TAG "# end Rabin pairs"
-#define BEGIN_SAFRA_TREES_TAG "# begin Safra trees"
-#define END_SAFRA_TREES_TAG "# end Safra trees"
-#define RABIN_EOF_TAG "# Rabin eof"
+    return explorer.GetRabinAutomaton();
+}
 
-// Buffer to hold 
-char buffer[100];
 
-// Input & output file streams
-std::fstream infile, outfile;
+// ================== Reporting statistics (--stats) ======================= //
 
-// ========================================================================== //
-// ========== PART 1 : Parsing input file to get Buechi automaton =========== //
-// ========================================================================== //
+// What --stats / --stats-json asked for, & the times measured outside of the
+//   explorer
+struct RunStats {
+    bool print;
+    const char *json_file_name;     // NULL if not requested, "-" for stdout
+    double parse_ms;
+    double minimize_ms;             // 0 unless --minimize was given
+    double write_ms;
+    int unminimized_states;         // Rabin states before --minimize
+};
+
+typedef std::chrono::steady_clock Clock;
+
+// What --checkpoint, --checkpoint-interval & --resume asked for
+struct CheckpointOptions {
+    const char *file_name;          // NULL if checkpoints are off
+    double interval_seconds;
+    bool resume;
+};
+
+// Seconds between checkpoints unless --checkpoint-interval says otherwise
+#define DEFAULT_CHECKPOINT_INTERVAL 600.0
+
+// What --binary, --hoa & --no-trees asked for
+struct OutputOptions {
+    bool binary;                    // the binary format of rabin_binary.h
+    bool hoa;                       // the HOA format of hoa_writer.h
+    bool with_trees;                // false only with --no-trees
+
+    // Names of the input's atomic propositions (set once it is parsed)
+    const std::vector<std::string> *atomic_propositions;
+};
 
 /*
- * Insert a transition from state #pre to state #post along character
+ * Reads a positive number of megabytes (--memory-budget) into bytes. Returns
+ *   false if text is not a whole number, is not positive, or does not fit in
+ *   a size_t once converted to bytes.
  */
-void InsertTransition(const int &pre_state, const int &character, 
-    const int &post_state, const int &num_states, std::vector<int64_t> &transitions) {
+bool ParseMegabytes(const char *text, size_t &bytes) {
 
-    transitions[character*num_states + pre_state] |= (1 << post_state);
+    char *end;
+    errno = 0;
+    long megabytes = strtol(text, &end, 10);
+
+    if (end == text || *end != '\0' || errno == ERANGE || megabytes <= 0 ||
+        (unsigned long) megabytes > (SIZE_MAX >> 20)) {
+        return false;
+    }
+    bytes = (size_t) megabytes << 20;
+    return true;
 }
 
+double MillisecondsSince(const Clock::time_point &start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
 
 /*
- * Read the (open) input file stream and populate the information about the
- *   Buechi automaton to the provided arugments. Returns true if the read
- *   produced a full, valid Buechi automaton, and false otherwise.
+ * Prints the phase timings & explorer counters as a table on stdout and/or as
+ *   one JSON object to run.json_file_name
  */
-bool ReadBeuchi(int &num_states, int &alphabet_size, int64_t &initial_states,
-    int64_t &final_states, std::vector<int64_t> &transitions) {
-
-    // Possible read states we can be in
-    enum ReadState {
-        INVALID,
-        WAIT_FOR_TAG,
-        READ_NUM_STATES,
-        READ_ALPHABET_SIZE,
-        READ_NUM_TRANSITIONS,
-        READ_TRANSITIONS,
-        READ_INITIAL_STATES,
-        READ_FINAL_STATES,
-        DONE
-    };
-
-    // Ensure that all fields start as invalid fields
-    bool found_num_states = false, found_alphabet_size = false,
-         found_initial_states = false, found_transitions = false,
-         found_num_transitions = false, found_final_states = false;
-
-    num_states = -1;
-    alphabet_size = -1;
-    initial_states = 0;
-    final_states = 0;
-    transitions.clear();
-
-    // Running count of the # of transitions we've read
-    int num_transitions = -1;
-    int transition_count = 0;
-
-    ReadState state = WAIT_FOR_TAG;
-
-    while (state != INVALID && state != DONE) {
-
-        infile.getline(buffer, BUFFER_SIZE, '\n');
-        std::string line(buffer);
-        std::stringstream linestream(line);
-
-        switch (state) {
-
-            // WAIT_FOR_TAG:
-            //   If we find a proper tag, switch to corresponding state
-            case (WAIT_FOR_TAG):
-                if (!line.compare(NUM_STATES_TAG)) {
-                    state = (found_num_states ? INVALID : READ_NUM_STATES);
-                }
-                else if (!line.compare(ALPHABET_SIZE_TAG)) {
-                    state = (found_alphabet_size ? INVALID : READ_ALPHABET_SIZE);
-                }
-                else if (!line.compare(NUM_TRANSITIONS_TAG)) {
-                    state = (found_num_transitions ? INVALID : READ_NUM_TRANSITIONS);
-                }
-                else if (!line.compare(BEGIN_TRANSITIONS_TAG)) {
-                    if (!found_transitions && found_num_states &&
-                        found_num_transitions && found_alphabet_size) {
-                        state = READ_TRANSITIONS;
-                    }
-                    else { state = INVALID; }
-                }
-                else if (!line.compare(INITIAL_STATES_TAG)) {
-                    state = (found_initial_states ? INVALID : READ_INITIAL_STATES);
-                }
-                else if (!line.compare(FINAL_STATES_TAG)) {
-                    state = (found_final_states ? INVALID : READ_FINAL_STATES);
-                }
-                else if (!line.compare(BUECHI_EOF_TAG)) {
-                    if (found_num_states && found_alphabet_size &&
-                        found_initial_states && found_transitions &&
-                        found_num_transitions && found_final_states) {
-                        state = DONE;
-                    }
-                    else { state = INVALID; }
-                }
-                else if (!line.compare(END_TRANSITIONS_TAG)) { state = INVALID; }
-                break;
-
-            // READ_NUM_STATES:
-            //   Parse a single number, set num_states, wait for new tag
-            case (READ_NUM_STATES):
-                if (found_num_states) { state = INVALID; }
-                else {
-                    found_num_states = true;
-                    linestream >> num_states;
-                    state = (num_states > 0 ? WAIT_FOR_TAG : INVALID);
-
-                    // If we have both num_states and alphabet_size, construct
-                    //   our transition vector
-                    if (alphabet_size > 0 && num_states > 0) {
-                        transitions = std::vector<int64_t>(alphabet_size*num_states, 0);
-                    }
-                }
-                break;
-
-            // READ_ALPHABET_SIZE:
-            //   Parse a single number, set alphabet_size, wait for new tag
-            case (READ_ALPHABET_SIZE):
-                if (found_alphabet_size) { state = INVALID; }
-                else {
-                    found_alphabet_size = true;
-                    linestream >> alphabet_size;
-                    state = (alphabet_size >= 0 ? WAIT_FOR_TAG : INVALID);
-
-                    // If we have both num_states and alphabet_size, construct
-                    //   our transition vector
-                    if (alphabet_size > 0 && num_states > 0) {
-                        transitions = std::vector<int64_t>(alphabet_size*num_states, 0);
-                    }
-                }
-                break;
-
-            // READ_NUM_TRANSITIONS:
-            //   Parse a single number, set num_transitions, wait for new tag
-            case (READ_NUM_TRANSITIONS):
-                if (found_num_transitions) { state = INVALID; }
-                else {
-                    found_num_transitions = true;
-                    linestream >> num_transitions;
-                    state = (num_transitions > 0 ? WAIT_FOR_TAG : INVALID);
-                }
-                break;
-
-            // READ_TRANSITIONS:
-            //   If we reach the end tag, check the # of transitions we've found
-            //     and compare it to the file's num_transitions. Otherwise, read
-            //     three integers and insert a transitions, incrementing the
-            //     running transition count
-            case (READ_TRANSITIONS):
-                if (!line.compare(END_TRANSITIONS_TAG)) {
-                    if (transition_count == num_transitions) {
-                        found_transitions = true;
-                        state = WAIT_FOR_TAG;
-                    }
-                    else { state = INVALID; }
-                }
-                else {
-                    int pre_state = -1, character = -1, post_state = -1;
-                    linestream >> pre_state;
-                    linestream >> character;
-                    linestream >> post_state;
-
-                    if (pre_state > 0 && pre_state <= num_states &&
-                        character > 0 && character <= alphabet_size &&
-                        post_state > 0 && post_state <= num_states) {
-                        // Switch from 1-indexing to 0-indexing
-                        InsertTransition(--pre_state, --character, --post_state, num_states, transitions);
-                    }
-                    else { state = INVALID; }
-                    transition_count++;
-                }
-                break;
-
-            // READ_INITIAL_STATES:
-            //   While there's still a number left to parse, add a state into
-            //   the initial_states bitvector
-            case (READ_INITIAL_STATES):
-                if (found_initial_states || !found_num_states) { state = INVALID; }
-                else {
-                    int i = -1;
-                    linestream >> i;
-                    while (i > 0 && i <= num_states) {
-                        i--; //switch from 1-indexing to 0-indexing
-                        initial_states |= (1 << i);
-                        i = -1;
-                        linestream >> i;
-                    }
-                    found_initial_states = true;
-                    state = WAIT_FOR_TAG;
-                }
-                break;
-
-            // READ_FINAL_STATES:
-            //   While there's still a number left to parse, add a state into
-            //   the final_states bitvector
-            case (READ_FINAL_STATES):
-                if (found_final_states || !found_num_states) { state = INVALID; }
-                else {
-                    int i = -1;
-                    linestream >> i;
-                    while (i > 0 && i <= num_states) {
-                        i--; // switch from 1-indexing to 0-indexing
-                        final_states |= (1 << i);
-                        i = -1;
-                        linestream >> i;
-                    }
-                    found_final_states = true;
-                    state = WAIT_FOR_TAG;
-                }
-                break;
-
-            default:
-                break;
+void ReportStats(const RunStats &run, const ExplorerStats &stats,
+    const int &num_rabin_states) {
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long peak_rss_kb = usage.ru_maxrss;
+
+    double load = (stats.table_slots > 0 ?
+        (double) stats.table_entries / stats.table_slots : 0.0);
+    double mean_probe = (stats.table_lookups > 0 ?
+        (double) stats.table_probes / stats.table_lookups : 0.0);
+
+    if (run.print) {
+        printf("Statistics:\n");
+        printf("  %-24s %12.3f ms\n", "parse", run.parse_ms);
+        printf("  %-24s %12.3f ms\n", "exploration", stats.explore_ms);
+        printf("  %-24s %12.3f ms\n", "renumber & Rabin pairs", stats.renumber_ms);
+        printf("  %-24s %12.3f ms\n", "minimize", run.minimize_ms);
+        printf("  %-24s %12.3f ms\n", "write", run.write_ms);
+        printf("  %-24s %12d\n", "Rabin states (explored)",
+            run.unminimized_states);
+        printf("  %-24s %12d\n", "Rabin states", num_rabin_states);
+        printf("  %-24s %12llu\n", "trees generated",
+            (unsigned long long) stats.trees_generated);
+        printf("  %-24s %12llu\n", "dedup hits",
+            (unsigned long long) stats.dedup_hits);
+        printf("  %-24s %12llu\n", "dedup misses",
+            (unsigned long long) stats.dedup_misses);
+        printf("  %-24s %12d\n", "max tree nodes", stats.max_tree_nodes);
+        printf("  %-24s %12d\n", "max tree depth", stats.max_tree_depth);
+        printf("  %-24s %12d of %d\n", "labels used", stats.labels_used,
+            stats.labels_available);
+        printf("  %-24s %12.3f (%llu of %llu slots)\n", "hash table load", load,
+            (unsigned long long) stats.table_entries,
+            (unsigned long long) stats.table_slots);
+        printf("  %-24s %12.3f (max %d)\n", "mean probe length", mean_probe,
+            stats.table_max_probe);
+        printf("  %-24s %12ld KiB\n", "peak memory", peak_rss_kb);
+    }
+
+    if (run.json_file_name != NULL) {
+        bool to_stdout = !strcmp(run.json_file_name, "-");
+        FILE *file = (to_stdout ? stdout : fopen(run.json_file_name, "w"));
+        if (file == NULL) {
+            std::cout << "ERROR: Could not write statistics file." << std::endl;
+            return;
         }
 
-        if (infile.fail()) { state = INVALID; }
+        fprintf(file, "{\"phases_ms\": {\"parse\": %.3f, \"exploration\": %.3f, "
+            "\"rabin_pairs\": %.3f, \"minimize\": %.3f, \"write\": %.3f}, ",
+            run.parse_ms, stats.explore_ms, stats.renumber_ms, run.minimize_ms,
+            run.write_ms);
+        fprintf(file, "\"explored_rabin_states\": %d, ", run.unminimized_states);
+        fprintf(file, "\"rabin_states\": %d, \"trees_generated\": %llu, "
+            "\"dedup_hits\": %llu, \"dedup_misses\": %llu, ", num_rabin_states,
+            (unsigned long long) stats.trees_generated,
+            (unsigned long long) stats.dedup_hits,
+            (unsigned long long) stats.dedup_misses);
+        fprintf(file, "\"max_tree_nodes\": %d, \"max_tree_depth\": %d, "
+            "\"labels_used\": %d, \"labels_available\": %d, ",
+            stats.max_tree_nodes, stats.max_tree_depth, stats.labels_used,
+            stats.labels_available);
+        fprintf(file, "\"hash_table\": {\"entries\": %llu, \"slots\": %llu, "
+            "\"load\": %.4f, \"lookups\": %llu, \"mean_probe\": %.4f, "
+            "\"max_probe\": %d}, ", (unsigned long long) stats.table_entries,
+            (unsigned long long) stats.table_slots, load,
+            (unsigned long long) stats.table_lookups, mean_probe,
+            stats.table_max_probe);
+        fprintf(file, "\"peak_rss_kb\": %ld}\n", peak_rss_kb);
+
+        if (!to_stdout) {
+            fclose(file);
+        }
     }
-    return (state == DONE);
 }
 
 
-// ========================================================================== //
-// ======= Part 2 : Running Safra's algorithm to get Rabin automaton ======== //
-// ========================================================================== //
+// ============= Running & writing for a fixed state set width ============= //
 
 /*
- * Runs Safra's algorithm on the provided Buechi automaton.
+ * Runs Safra's algorithm on the parsed Buechi automaton using W-word state
+ *   sets, minimizes the result if asked to, then writes it to the output file
+ *   (and the statistics, if requested). Returns main's exit code.
  */
-std::vector<std::unordered_map<int, int>> RunSafra(int num_states, int alphabet_size,
-    int64_t initial_states, int64_t final_states,
-    std::vector<int64_t> transitions,
-    std::unordered_set<int> *rabin_lefts, std::unordered_set<int> *rabin_rights,
-    std::unordered_map<std::string, std::pair<int, SafraTree *>> &tree_mapping) {
+template <int W>
+int DeterminizeAndWrite(const char *input_file_name,
+    const char *output_file_name, const BuchiAutomaton &automaton,
+    int num_threads, bool canonical_labels, bool minimize,
+    const CheckpointOptions &checkpoint, const OutputOptions &output,
+    RunStats &run) {
 
-    // task_queue contains strings for all trees whose transitions have not
-    //   been computed yet
-    std::queue<std::string> task_queue;
-    int next_tree_label = 0;
+    // ======================= RUN SAFRA'S ALGORITHM ======================== //
 
-    // build initially empty Rabin transition table
-    std::vector<std::unordered_map<int, int>> rabin_transitions;
-    for (int i = 0; i < alphabet_size; i++) {
-        rabin_transitions.push_back({});
-    }
+    std::cout << "Extraction done. Running Safra's algorithm..." << std::endl;
 
-    // Create initial tree, add it to task queue & tree_mapping
+    // explorer : holds every Safra tree of this run (encoded), numbered by
+    //   Rabin state
+    SafraExplorer<W> explorer(&automaton, num_threads, canonical_labels,
+        SafraAllocator());
 
-    SafraTree *initial_tree = new SafraTree(num_states, alphabet_size,
-        transitions, initial_states, final_states);
+    if (checkpoint.file_name != NULL) {
+        struct stat info;
+        std::string error;
 
-    std::string initial_string = initial_tree->ToString();
+        if (checkpoint.resume && stat(checkpoint.file_name, &info) == 0) {
+            if (!explorer.LoadCheckpoint(checkpoint.file_name, error)) {
+                std::cout << "ERROR: Cannot resume (" << error << ")." << std::endl;
+                return 1;
+            }
+            std::cout << "Resuming from checkpoint " << checkpoint.file_name;
+            std::cout << "..." << std::endl;
+        }
+        else if (checkpoint.resume) {
+            std::cout << "No checkpoint " << checkpoint.file_name;
+            std::cout << " yet, starting from the beginning." << std::endl;
+        }
 
-    tree_mapping[initial_string] = std::make_pair(next_tree_label++, initial_tree);
-    task_queue.push(initial_string);
+        explorer.SetCheckpoint(checkpoint.file_name, checkpoint.interval_seconds);
+    }
 
-    // Keep processing trees until the task queue is empty
+    const RabinAutomaton *rabin = &RunSafra(explorer);
 
-    while (!task_queue.empty()) {
+    if (!explorer.GetCheckpointError().empty()) {
+        std::cout << "WARNING: Checkpoints stopped (";
+        std::cout << explorer.GetCheckpointError() << ")." << std::endl;
+    }
 
-        std::string tree_string = task_queue.front();
-        task_queue.pop();
+    run.unminimized_states = rabin->GetNumStates();
 
-        SafraTree *tree = tree_mapping[tree_string].second;
-        for (int character = 0; character < alphabet_size; character++) {
+    // ====================== MINIMIZE (--minimize) ========================= //
 
-            // Find the resulting tree for each character
-            SafraTree *transition_tree = new SafraTree(tree, character);
-            std::string transition_string = transition_tree->ToString();
+    // minimized : quotient of the explored automaton, where each state shows
+    //   the tree of the lowest explored state merged into it
+    RabinAutomaton minimized;
+    std::vector<int> representatives;
+    const std::vector<int> *tree_states = NULL;
 
-            // If it's not in the mapping already, add it into the mapping and
-            //   task queue
-            if (tree_mapping.find(transition_string) == tree_mapping.end()) {
+    if (minimize) {
+        Clock::time_point start = Clock::now();
 
-                tree_mapping[transition_string] = std::make_pair(
-                    next_tree_label++, transition_tree);
+        minimized = MinimizeRabin(*rabin, representatives);
 
-                task_queue.push(transition_string);
-            }
-            // Otherwise, delete the SafraTree pointer (we already have one in
-            //   the mapping)
-            else {
-                delete transition_tree;
-            }
+        run.minimize_ms = MillisecondsSince(start);
 
-            // In either case, add a transition into rabin_transitions
-            int pre_label = tree_mapping[tree_string].first;
-            int post_label = tree_mapping[transition_string].first;
+        std::cout << "Minimized the Rabin automaton from ";
+        std::cout << rabin->GetNumStates() << " to " << minimized.GetNumStates();
+        std::cout << " states." << std::endl;
 
-            rabin_transitions[character][pre_label] = post_label;
-        }
+        rabin = &minimized;
+        tree_states = &representatives;
     }
 
-    // We now have all of the states and transitions in our Rabin automaton;
-    //   all that remains is to compute the Rabin pairs
-    
-    // iterates over (string, (int, SafraTree*)) objects
-    for (auto mapping_pair : tree_mapping) {
+    // ======================= WRITE TO OUTPUT FILE ========================= //
 
-        int tree_label = mapping_pair.second.first;
-        SafraTree *tree = mapping_pair.second.second;
+    std::cout << "Safra's algorithm done. Writing result to file ";
+    std::cout << output_file_name << "..." << std::endl;
 
-        bool **state_info = tree->GetLabelInfo(2*num_states);
+    Clock::time_point start = Clock::now();
 
-        for (int i = 0; i < 2*num_states; i++) {
-            if (state_info[i][1]) {
-                // this state is a marked node in the tree
-                rabin_rights[i].insert(tree_label);
-            } else if (state_info[i][0]) {
-                // this state is an unmarked node in the tree
-                // not in left or right side
-            } else {
-                // this state is not in the tree
-                rabin_lefts[i].insert(tree_label);
-            }
-        }
+    // Open output file
+    OutputBuffer outfile;
+    if (!outfile.Open(output_file_name)) {
+        std::cout << "ERROR: Improper output filename." << std::endl;
+        return 1;
+    }
 
-        // Delete state_info
-        for (int i = 0; i < 2*num_states; i++) {
-            delete[] state_info[i];
-        }
-        delete[] state_info;   
+    if (output.binary) {
+        WriteRabinBinary<W>(outfile, input_file_name, *rabin, explorer,
+            tree_states, output.with_trees);
+    }
+    else if (output.hoa) {
+        WriteRabinHoa<W>(outfile, input_file_name, *rabin,
+            *output.atomic_propositions, explorer, tree_states,
+            output.with_trees);
+    }
+    else {
+        WriteRabin<W>(outfile, input_file_name, *rabin, explorer, tree_states);
     }
 
-    // Now Rabin rights and Rabin lefts should be initialized correctly
-    // where matching indices correspond to pairs
-    return rabin_transitions;
-}
+    // Close output file
+    if (!outfile.Close()) {
+        std::cout << "ERROR: Could not write output file." << std::endl;
+        return 1;
+    }
 
+    run.write_ms = MillisecondsSince(start);
 
-// ========================================================================== //
-// ===== Part 3: Writing Rabin automaton & Safra trees to output file ======= //
-// ========================================================================== //
+    // The result is complete, so there is nothing left to resume
+    if (checkpoint.file_name != NULL) {
+        remove(checkpoint.file_name);
+    }
 
-/*
- * Writes the contents of the computed Rabin automaton to the specified output
- *   file stream.
- */
-void WriteRabin(std::string input_file_name,
-    int num_rabin_states,
-    int alphabet_size,
-    int num_labels,
-    int initial_state,
-    int num_transitions,
-    std::vector<std::unordered_map<int, int>> transitions,
-    std::unordered_set<int> *rabin_lefts,
-    std::unordered_set<int> *rabin_rights,
-    std::unordered_map<std::string, std::pair<int, SafraTree *>> tree_mapping) {
-
-    outfile << "RABIN" << std::endl;
-    outfile << RABIN_INFILE_TAG << std::endl;
-    outfile << input_file_name << std::endl;
-
-    outfile << NUM_STATES_TAG << std::endl;
-    outfile << num_rabin_states << std::endl;
-
-    outfile << ALPHABET_SIZE_TAG << std::endl;
-    outfile << alphabet_size << std::endl;
-
-    outfile << NUM_TRANSITIONS_TAG << std::endl;
-    outfile << num_transitions << std::endl;
-
-    outfile << BEGIN_TRANSITIONS_TAG << std::endl;
-        
-    for (int c = 0; c < transitions.size(); c++) {
-        for (auto mapping_pair : transitions[c]) {
-            outfile << mapping_pair.first+1 << "  ";
-            outfile << c+1 << "  ";
-            outfile << mapping_pair.second+1 << std::endl;
-        }
+    std::cout << "Done.\n";
+
+    if (run.print || run.json_file_name != NULL) {
+        ReportStats(run, explorer.GetStats(), rabin->GetNumStates());
     }
 
-    outfile << END_TRANSITIONS_TAG << std::endl;
+    return 0;
+}
 
-    outfile << RABIN_INITIAL_STATE_TAG << std::endl;
-    outfile << initial_state+1 << std::endl;
 
-    outfile << BEGIN_RABIN_PAIRS_TAG << std::endl;
+/*
+ * Same as DeterminizeAndWrite, but explores with a SpillExplorer that keeps
+ *   about memory_budget bytes in memory & the rest in spill_directory, and
+ *   streams the result from there into the output file (--spill-dir). The
+ *   exploration runs on one thread & goes through the disk even if it would
+ *   fit in memory_budget.
+ */
+template <int W>
+int SpillAndWrite(const char *input_file_name, const char *output_file_name,
+    const BuchiAutomaton &automaton, bool canonical_labels,
+    const char *spill_directory, const size_t &memory_budget, RunStats &run) {
 
-    for (int i = 0; i < num_labels; i++) {
+    std::cout << "Extraction done. Running Safra's algorithm, spilling to ";
+    std::cout << spill_directory << "..." << std::endl;
 
-        // Only read a new Rabin pair if the right side isn't empty
-        if (!rabin_rights[i].empty()) {
+    SpillExplorer<W> explorer(&automaton, canonical_labels, memory_budget,
+        spill_directory);
+    std::string error;
 
-            outfile << "L={ ";
+    if (!explorer.Run(error)) {
+        std::cout << "ERROR: Exploration failed (" << error << ")." << std::endl;
+        return 1;
+    }
+    run.unminimized_states = explorer.GetNumStates();
 
-            // Write every left label
-            for (int left : rabin_lefts[i]) {
-                outfile << left+1 << " ";
-            }
+    std::cout << "Safra's algorithm done. Writing result to file ";
+    std::cout << output_file_name << "..." << std::endl;
 
-            // Insert divider
-            outfile << "}, R={ ";
+    Clock::time_point start = Clock::now();
 
-            // Write every right label
-            for (int right : rabin_rights[i]) {
-                outfile << right+1 << " ";
-            }
-            outfile << "}" << std::endl;
-        }
+    OutputBuffer outfile;
+    if (!outfile.Open(output_file_name)) {
+        std::cout << "ERROR: Improper output filename." << std::endl;
+        return 1;
     }
 
-    outfile << END_RABIN_PAIRS_TAG << std::endl;
-    outfile << BEGIN_SAFRA_TREES_TAG << std::endl;
-
-    std::map<int, std::string> ordered_tree_mapping = {};
+    if (!explorer.WriteRabin(outfile, input_file_name, error)) {
+        std::cout << "ERROR: Could not write output file (" << error << ").";
+        std::cout << std::endl;
+        return 1;
+    }
 
-    for (auto mapping_pair : tree_mapping) {
-        ordered_tree_mapping.insert(
-            std::make_pair(mapping_pair.second.first, mapping_pair.first));
+    if (!outfile.Close()) {
+        std::cout << "ERROR: Could not write output file." << std::endl;
+        return 1;
     }
 
-    for (auto ordered_mapping_pair : ordered_tree_mapping) {
-        outfile << ordered_mapping_pair.first+1 << ": ";
-        outfile << ordered_mapping_pair.second << std::endl;
+    run.write_ms = MillisecondsSince(start);
+
+    std::cout << "Done.\n";
+
+    if (run.print || run.json_file_name != NULL) {
+        ReportStats(run, explorer.GetStats(), explorer.GetNumStates());
     }
 
-    outfile << END_SAFRA_TREES_TAG << std::endl;
-    outfile << RABIN_EOF_TAG << std::endl;
+    return 0;
 }
 
 
-// ==================== Main method for Safra's algorithm =================== //
+// ============================ Batch mode (--batch) ======================== //
 
-int main(int argc, const char *argv[]) {
+/*
+ * Determinizes every file listed by input_path (a manifest or a directory)
+ *   into output_directory on num_threads threads, and writes the batch
+ *   summary. Returns main's exit code: 1 unless every file succeeded.
+ */
+int RunBatchMode(const char *input_path, const char *output_directory,
+    int num_threads, bool canonical_labels, bool minimize) {
 
-    if (argc != 3) {
-        std::cout << "ERROR: Incorrect argument format. ";
-        std::cout << "Usage: ./safra <ipnutfile> <outputfile>  ";
-        std::cout << "(file format in info.txt)" << std::endl;
+    std::vector<BatchJob> jobs;
+    std::string error;
+
+    if (!ListBatchJobs(input_path, output_directory, jobs, error)) {
+        std::cout << "ERROR: Batch input: " << error << "." << std::endl;
         return 1;
     }
 
-    std::cout << "Extracting Buechi automaton from file " << argv[1];
-    std::cout << "..." << std::endl;
-
-    // ========================= PROCESS INPUT FILE ========================= //
-
-    infile.open(argv[1], std::ios::in);
-    if (!infile.is_open()) {
-        std::cout << "ERROR: Improper input filename." << std::endl;
+    if (mkdir(output_directory, 0755) != 0 && errno != EEXIST) {
+        std::cout << "ERROR: Could not create output directory ";
+        std::cout << output_directory << "." << std::endl;
         return 1;
     }
 
-    int num_states, alphabet_size;
-    int64_t initial_states, final_states;
-    std::vector<int64_t> transitions;
+    std::cout << "Determinizing " << jobs.size() << " automata on ";
+    std::cout << num_threads << " threads..." << std::endl;
 
-    if (!ReadBeuchi(num_states, alphabet_size, initial_states,
-        final_states, transitions)) {
+    Clock::time_point start = Clock::now();
+    RunBatch(jobs, num_threads, canonical_labels, minimize);
+    double batch_ms = MillisecondsSince(start);
 
-        std::cout << "Error: Improperly formatted input file. ";
-        std::cout << "Please look to info.txt for input file format.\n";
+    int num_ok = 0;
+    double parse_ms = 0, explore_ms = 0, write_ms = 0;
+    for (const BatchJob &job : jobs) {
+        if (job.ok) {
+            num_ok++;
+        }
+        else {
+            std::cout << "ERROR: " << job.input_file_name << ": " << job.error;
+            std::cout << "." << std::endl;
+        }
+        parse_ms += job.parse_ms;
+        explore_ms += job.explore_ms;
+        write_ms += job.write_ms;
+    }
+
+    std::string summary_file_name = std::string(output_directory) + "/" +
+        BATCH_SUMMARY_FILE_NAME;
+    if (!WriteBatchSummary(summary_file_name.c_str(), jobs)) {
+        std::cout << "ERROR: Could not write batch summary." << std::endl;
         return 1;
     }
 
-    infile.close();
+    printf("Done: %d of %d automata in %.3f ms (summed over jobs: parse %.3f ms, "
+        "explore %.3f ms, write %.3f ms).\n", num_ok, (int) jobs.size(),
+        batch_ms, parse_ms, explore_ms, write_ms);
+    std::cout << "Summary written to " << summary_file_name << "." << std::endl;
 
-    // ======================= RUN SAFRA'S ALGORITHM ======================== //
+    return (num_ok == (int) jobs.size() ? 0 : 1);
+}
 
-    std::cout << "Extraction done. Running Safra's algorithm..." << std::endl;
 
-    std::unordered_set<int> *rabin_lefts =
-        new std::unordered_set<int>[2*num_states];
-    std::unordered_set<int>
-        *rabin_rights = new std::unordered_set<int>[2*num_states];
+// ==================== Main method for Safra's algorithm =================== //
+
+int main(int argc, const char *argv[]) {
 
-    for (int i = 0; i < 2*num_states; i++) {
-        rabin_lefts[i] = std::unordered_set<int>();
-        rabin_rights[i] = std::unordered_set<int>();
+    // Parse options, leaving the input & output file names
+    int num_threads = 1;
+    bool canonical_labels = false;
+    bool minimize = false;
+    bool batch = false;
+    const char *spill_directory = NULL;
+    size_t memory_budget = DEFAULT_MEMORY_BUDGET;
+    CheckpointOptions checkpoint = { NULL, DEFAULT_CHECKPOINT_INTERVAL, false };
+    OutputOptions output = { false, false, true, NULL };
+    RunStats run = { false, NULL, 0, 0, 0, 0 };
+    std::vector<const char *> file_names;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--canonical")) {
+            canonical_labels = true;
+        }
+        else if (!strcmp(argv[i], "--batch")) {
+            batch = true;
+        }
+        else if (!strcmp(argv[i], "--minimize")) {
+            minimize = true;
+        }
+        else if (!strcmp(argv[i], "--spill-dir") && i + 1 < argc) {
+            spill_directory = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--memory-budget") && i + 1 < argc) {
+            // An unparsable budget is 0, which the check below refuses
+            if (!ParseMegabytes(argv[++i], memory_budget)) {
+                memory_budget = 0;
+            }
+        }
+        else if (!strcmp(argv[i], "--checkpoint") && i + 1 < argc) {
+            checkpoint.file_name = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--checkpoint-interval") && i + 1 < argc) {
+            checkpoint.interval_seconds = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--resume")) {
+            checkpoint.resume = true;
+        }
+        else if (!strcmp(argv[i], "--binary")) {
+            output.binary = true;
+        }
+        else if (!strcmp(argv[i], "--hoa")) {
+            output.hoa = true;
+        }
+        else if (!strcmp(argv[i], "--no-trees")) {
+            output.with_trees = false;
+        }
+        else if (!strcmp(argv[i], "--stats")) {
+            run.print = true;
+        }
+        else if (!strcmp(argv[i], "--stats-json") && i + 1 < argc) {
+            run.json_file_name = argv[++i];
+        }
+        else {
+            file_names.push_back(argv[i]);
+        }
     }
 
-    // tree_mapping : (string representation of tree -> label, SafraTree ptr)
-    std::unordered_map<std::string, std::pair<int, SafraTree *>> tree_mapping = {};
+    if (file_names.size() != 2 || num_threads < 1 || memory_budget == 0 ||
+        checkpoint.interval_seconds <= 0 ||
+        (checkpoint.resume && checkpoint.file_name == NULL) ||
+        (!output.with_trees && !output.binary && !output.hoa) ||
+        (output.binary && output.hoa)) {
+        std::cout << "ERROR: Incorrect argument format. ";
+        std::cout << "Usage: ./safra [--threads N] [--canonical] [--minimize] ";
+        std::cout << "[--spill-dir DIR [--memory-budget MB]] ";
+        std::cout << "[--checkpoint FILE [--checkpoint-interval SECONDS] ";
+        std::cout << "[--resume]] [--binary | --hoa [--no-trees]] ";
+        std::cout << "[--stats] [--stats-json FILE] ";
+        std::cout << "<ipnutfile> <outputfile>  ";
+        std::cout << "or ./safra --batch [options] <manifest|directory> ";
+        std::cout << "<outputdirectory>  ";
+        std::cout << "(file format in info.txt)" << std::endl;
+        return 1;
+    }
 
-    auto rabin_transitions = RunSafra(num_states, alphabet_size, initial_states,
-        final_states, transitions, rabin_lefts, rabin_rights, tree_mapping);    
+    const char *input_file_name = file_names[0];
+    const char *output_file_name = file_names[1];
 
-    // ======================= WRITE TO OUTPUT FILE ========================= //
+    // The spilling explorer never holds the whole automaton, which both of
+    //   these need
+    if (spill_directory != NULL && (minimize || batch)) {
+        std::cout << "ERROR: --spill-dir cannot be combined with ";
+        std::cout << (minimize ? "--minimize" : "--batch") << "." << std::endl;
+        return 1;
+    }
+    if (spill_directory != NULL && num_threads > 1) {
+        std::cout << "WARNING: --spill-dir explores on a single thread, ";
+        std::cout << "--threads is ignored." << std::endl;
+    }
+    if (checkpoint.file_name != NULL && (spill_directory != NULL || batch)) {
+        std::cout << "ERROR: --checkpoint cannot be combined with ";
+        std::cout << (batch ? "--batch" : "--spill-dir") << "." << std::endl;
+        return 1;
+    }
+    if (output.binary && (spill_directory != NULL || batch)) {
+        std::cout << "ERROR: --binary cannot be combined with ";
+        std::cout << (batch ? "--batch" : "--spill-dir") << " (convert the ";
+        std::cout << "text output with ./rabin_convert)." << std::endl;
+        return 1;
+    }
+    if (output.hoa && (spill_directory != NULL || batch)) {
+        std::cout << "ERROR: --hoa cannot be combined with ";
+        std::cout << (batch ? "--batch" : "--spill-dir") << "." << std::endl;
+        return 1;
+    }
+
+    if (batch) {
+        return RunBatchMode(input_file_name, output_file_name, num_threads,
+            canonical_labels, minimize);
+    }
 
-    std::cout << "Safra's algorithm done. Writing result to file " << argv[2];
+    std::cout << "Extracting Buechi automaton from file " << input_file_name;
     std::cout << "..." << std::endl;
 
-    // Open output file
-    outfile.open(argv[2], std::ios::out);
-    if (!outfile.is_open()) {
-        std::cout << "ERROR: Improper output filename." << std::endl;
+    // ========================= PROCESS INPUT FILE ========================= //
+
+    Clock::time_point start = Clock::now();
+
+    MappedFile infile;
+    if (!infile.Open(input_file_name)) {
+        std::cout << "ERROR: Improper input filename." << std::endl;
         return 1;
     }
 
-    WriteRabin(argv[1], tree_mapping.size(), alphabet_size, 2*num_states, 0, 
-        alphabet_size*tree_mapping.size(), rabin_transitions, rabin_lefts,
-        rabin_rights, tree_mapping);
+    BuchiAutomaton automaton;
+    int num_states;
+    std::string error;
+    std::vector<std::string> atomic_propositions;
+
+    // A HOA file names its atomic propositions; a .aut file's letters get
+    //   default ones in case the output is HOA
+    bool parsed;
+    if (IsHoa(infile.GetData(), infile.GetSize())) {
+        parsed = ParseHoa(infile.GetData(), infile.GetSize(), automaton,
+            num_states, atomic_propositions, error);
+    }
+    else {
+        parsed = ParseBuechi(infile.GetData(), infile.GetSize(), automaton,
+            num_states, error);
+        if (parsed) {
+            atomic_propositions =
+                DefaultAtomicPropositions(automaton.GetAlphabetSize());
+        }
+    }
+    output.atomic_propositions = &atomic_propositions;
 
-    // Clear out any leftover pointers
-    delete[] rabin_lefts;
-    delete[] rabin_rights;
+    if (!parsed) {
 
-    for (auto mapping_pair : tree_mapping) {
-        delete mapping_pair.second.second;
+        if (num_states > MAX_BUECHI_STATES) {
+            std::cout << "ERROR: Automata with more than " << MAX_BUECHI_STATES;
+            std::cout << " states are not supported." << std::endl;
+            return 1;
+        }
+        std::cout << "Error: Improperly formatted input file (" << error;
+        std::cout << "). Please look to info.txt for input file format.\n";
+        return 1;
     }
 
-    // Close output file
-    outfile.close();
-
-    std::cout << "Done.\n";
+    run.parse_ms = MillisecondsSince(start);
+
+    // Pick the narrowest state set width that holds every Buechi state
+    switch (automaton.GetNumWords()) {
+#define DETERMINIZE_WITH_WIDTH(W)                                               \
+        case W:                                                                 \
+            if (spill_directory != NULL) {                                      \
+                return SpillAndWrite<W>(input_file_name, output_file_name,      \
+                    automaton, canonical_labels, spill_directory,               \
+                    memory_budget, run);                                        \
+            }                                                                   \
+            return DeterminizeAndWrite<W>(input_file_name, output_file_name,   \
+                automaton, num_threads, canonical_labels, minimize,             \
+                checkpoint, output, run);
+        SAFRA_FOR_EACH_WIDTH(DETERMINIZE_WITH_WIDTH)
+#undef DETERMINIZE_WITH_WIDTH
+        default:
+            break;
+    }
 
-    return 0;
-}
\ No newline at end of file
+    std::cout << "ERROR: No state set width for " << num_states;
+    std::cout << " states." << std::endl;
+    return 1;
+}
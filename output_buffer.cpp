@@ -0,0 +1,99 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *     output_buffer.cpp - buffered, chunked writer for large output files    *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "output_buffer.h"
+
+OutputBuffer::OutputBuffer() {
+    fd_ = -1;
+    failed_ = false;
+    buffer_ = std::vector<char>(OUTPUT_CHUNK_SIZE);
+    used_ = 0;
+    written_ = 0;
+}
+
+OutputBuffer::OutputBuffer(const size_t &chunk_size) {
+    fd_ = -1;
+    failed_ = false;
+    buffer_ = std::vector<char>(chunk_size > 0 ? chunk_size : 1);
+    used_ = 0;
+    written_ = 0;
+}
+
+OutputBuffer::~OutputBuffer() {
+    Close();
+}
+
+bool OutputBuffer::Open(const char *file_name) {
+    return OpenWithFlags(file_name, O_WRONLY | O_CREAT | O_TRUNC);
+}
+
+bool OutputBuffer::OpenForAppend(const char *file_name) {
+    return OpenWithFlags(file_name, O_WRONLY | O_CREAT | O_APPEND);
+}
+
+bool OutputBuffer::OpenWithFlags(const char *file_name, const int &flags) {
+
+    Close();
+
+    fd_ = open(file_name, flags, 0644);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    failed_ = false;
+    used_ = 0;
+    written_ = 0;
+    return true;
+}
+
+bool OutputBuffer::Close() {
+
+    if (fd_ < 0) {
+        return !failed_;
+    }
+
+    Flush();
+    if (close(fd_) != 0) {
+        failed_ = true;
+    }
+    fd_ = -1;
+
+    return !failed_;
+}
+
+void OutputBuffer::Flush() {
+    WriteOut(&buffer_[0], used_);
+    used_ = 0;
+}
+
+/*
+ * Hands length bytes to the operating system, retrying on partial writes
+ */
+void OutputBuffer::WriteOut(const char *data, size_t length) {
+
+    written_ += length;
+
+    while (length > 0 && !failed_) {
+        ssize_t written = write(fd_, data, length);
+
+        if (written < 0) {
+            if (errno != EINTR) { failed_ = true; }
+            continue;
+        }
+
+        data += written;
+        length -= written;
+    }
+}
@@ -0,0 +1,123 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *       output_buffer.h - buffered, chunked writer for large output files    *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Bytes collected before they are handed to the operating system in one write
+#define OUTPUT_CHUNK_SIZE (1 << 20)
+
+/*
+ * Writes a file through one reusable in-memory buffer. Text is appended to the
+ *   buffer (integers are formatted directly into it) and only written out when
+ *   a whole chunk has been collected, so producing the output never flushes
+ *   per line or builds intermediate strings.
+ */
+class OutputBuffer {
+public:
+
+    // The buffer holds chunk_size bytes (OUTPUT_CHUNK_SIZE by default)
+    OutputBuffer();
+    explicit OutputBuffer(const size_t &chunk_size);
+    ~OutputBuffer();
+
+    // Creates / truncates the named file, returning false if it cannot be opened
+    bool Open(const char *file_name);
+
+    // Opens the named file for writing at its end, creating it if needed
+    bool OpenForAppend(const char *file_name);
+
+    // Writes out whatever is buffered & closes the file. Returns false if any
+    //   write failed.
+    bool Close();
+
+    void Write(const char *text, const size_t &length) {
+        if (used_ + length > buffer_.size()) {
+            Flush();
+            if (length > buffer_.size()) {
+                WriteOut(text, length);
+                return;
+            }
+        }
+        memcpy(&buffer_[used_], text, length);
+        used_ += length;
+    }
+
+    void Write(const char *text) {
+        Write(text, strlen(text));
+    }
+
+    void Write(const std::string &text) {
+        Write(text.data(), text.size());
+    }
+
+    void WriteChar(const char &c) {
+        if (used_ == buffer_.size()) {
+            Flush();
+        }
+        buffer_[used_++] = c;
+    }
+
+    // Writes the decimal form of value
+    void WriteInt(uint64_t value) {
+        char digits[20];
+        int length = 0;
+        do {
+            digits[sizeof(digits) - 1 - length++] = '0' + (value % 10);
+            value /= 10;
+        } while (value != 0);
+        Write(&digits[sizeof(digits) - length], length);
+    }
+
+    // Writes value as a varint (7 bits per byte, least significant first),
+    //   returning the number of bytes written
+    int WriteVarint(uint64_t value) {
+        char bytes[10];
+        int length = 0;
+        while (value >= 0x80) {
+            bytes[length++] = (char) (value | 0x80);
+            value >>= 7;
+        }
+        bytes[length++] = (char) value;
+        Write(bytes, length);
+        return length;
+    }
+
+    // Writes text followed by a newline
+    void WriteLine(const char *text) {
+        Write(text);
+        WriteChar('\n');
+    }
+
+    // Bytes written since the file was opened, buffered ones included
+    uint64_t GetPosition() const {
+        return written_ + used_;
+    }
+
+private:
+    OutputBuffer(const OutputBuffer &);
+    OutputBuffer &operator=(const OutputBuffer &);
+
+    bool OpenWithFlags(const char *file_name, const int &flags);
+    void Flush();
+    void WriteOut(const char *data, size_t length);
+
+    int fd_;
+    bool failed_;
+
+    std::vector<char> buffer_;
+    size_t used_;
+    uint64_t written_;
+};
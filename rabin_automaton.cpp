@@ -0,0 +1,70 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *  rabin_automaton.cpp - deterministic Rabin automaton built by Safra's alg. *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include "rabin_automaton.h"
+
+RabinAutomaton::RabinAutomaton() {
+    num_states_ = 0;
+    alphabet_size_ = 0;
+    num_labels_ = 0;
+    num_state_words_ = 0;
+}
+
+RabinAutomaton::RabinAutomaton(int num_states, int alphabet_size,
+    int num_labels) {
+
+    assert(num_states > 0 && alphabet_size >= 0 && num_labels >= 0);
+
+    num_states_ = num_states;
+    alphabet_size_ = alphabet_size;
+    num_labels_ = num_labels;
+    num_state_words_ = (num_states + 63) / 64;
+
+    transitions_ = std::vector<uint32_t>((size_t) num_states * alphabet_size, 0);
+    lefts_ = std::vector<uint64_t>((size_t) num_labels * num_state_words_, 0);
+    rights_ = std::vector<uint64_t>((size_t) num_labels * num_state_words_, 0);
+}
+
+int RabinAutomaton::GetNumStates() const {
+    return num_states_;
+}
+
+int RabinAutomaton::GetAlphabetSize() const {
+    return alphabet_size_;
+}
+
+/*
+ * The initial Safra tree is always numbered first
+ */
+int RabinAutomaton::GetInitialState() const {
+    return 0;
+}
+
+uint64_t RabinAutomaton::GetNumTransitions() const {
+    return transitions_.size();
+}
+
+int RabinAutomaton::GetNumLabels() const {
+    return num_labels_;
+}
+
+int RabinAutomaton::GetNumStateWords() const {
+    return num_state_words_;
+}
+
+bool RabinAutomaton::IsRightEmpty(const int &label) const {
+    const uint64_t *right = GetRight(label);
+    for (int w = 0; w < num_state_words_; w++) {
+        if (right[w] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,104 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *   rabin_automaton.h - deterministic Rabin automaton built by Safra's alg.  *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <vector>
+
+/*
+ * A deterministic Rabin automaton: states 0..N-1, letters 0..|Sigma|-1,
+ *   exactly one successor per (state, letter) pair, and one Rabin pair (L, R)
+ *   per Safra node label. Successors live in one dense N x |Sigma| block,
+ *   state-major, so the |Sigma| transitions out of a state are contiguous.
+ *
+ * Each side of a Rabin pair is a bitvector over the N states, stored as
+ *   GetNumStateWords() consecutive 64-bit words (state i is bit i % 64 of
+ *   word i / 64), so the sets take N / 8 bytes each and list in state order.
+ */
+class RabinAutomaton {
+public:
+
+    RabinAutomaton();
+    RabinAutomaton(int num_states, int alphabet_size, int num_labels);
+
+    int GetNumStates() const;
+    int GetAlphabetSize() const;
+    int GetInitialState() const;
+    uint64_t GetNumTransitions() const;
+    int GetNumLabels() const;
+    int GetNumStateWords() const;
+
+    uint32_t GetSuccessor(const int &state, const int &character) const {
+        assert(state >= 0 && state < num_states_);
+        assert(character >= 0 && character < alphabet_size_);
+        return transitions_[(size_t) state * alphabet_size_ + character];
+    }
+
+    // The |Sigma| successors of state, indexed by character
+    const uint32_t *GetSuccessors(const int &state) const {
+        assert(state >= 0 && state < num_states_);
+        return &transitions_[(size_t) state * alphabet_size_];
+    }
+
+    void SetSuccessor(const int &state, const int &character,
+        const uint32_t &post_state) {
+        assert(state >= 0 && state < num_states_);
+        assert(character >= 0 && character < alphabet_size_);
+        assert((int) post_state < num_states_);
+        transitions_[(size_t) state * alphabet_size_ + character] = post_state;
+    }
+
+    // Rabin pair of label: L holds the states whose Safra tree does not use
+    //   the label, R the states whose tree has it on a marked node
+    void AddToLeft(const int &label, const int &state) {
+        InsertState(&lefts_[PairOffset(label)], state);
+    }
+
+    void AddToRight(const int &label, const int &state) {
+        InsertState(&rights_[PairOffset(label)], state);
+    }
+
+    const uint64_t *GetLeft(const int &label) const {
+        return &lefts_[PairOffset(label)];
+    }
+
+    const uint64_t *GetRight(const int &label) const {
+        return &rights_[PairOffset(label)];
+    }
+
+    bool IsRightEmpty(const int &label) const;
+
+private:
+
+    size_t PairOffset(const int &label) const {
+        assert(label >= 0 && label < num_labels_);
+        return (size_t) label * num_state_words_;
+    }
+
+    void InsertState(uint64_t *set, const int &state) {
+        assert(state >= 0 && state < num_states_);
+        set[state / 64] |= (uint64_t(1) << (state % 64));
+    }
+
+    int num_states_;
+    int alphabet_size_;
+    int num_labels_;
+    int num_state_words_;
+
+    // transitions_[state * alphabet_size_ + character] is the successor
+    std::vector<uint32_t> transitions_;
+
+    // lefts_ & rights_ hold num_state_words_ words per label, in label order
+    std::vector<uint64_t> lefts_;
+    std::vector<uint64_t> rights_;
+};
@@ -0,0 +1,311 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *    rabin_binary.cpp - binary (mmap-able) file format for Rabin automata    *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include <cstring>
+
+#include "rabin_binary.h"
+
+// Bytes needed to pad length up to a multiple of 8
+static uint64_t PaddingFor(const uint64_t &length) {
+    return (8 - length % 8) % 8;
+}
+
+static void WritePadding(OutputBuffer &out) {
+    static const char zeros[8] = { 0 };
+    out.Write(zeros, PaddingFor(out.GetPosition()));
+}
+
+
+// ========================================================================== //
+// ================================ Writing ================================= //
+// ========================================================================== //
+
+/*
+ * Writes everything up to the trees: the header, the input file name, the
+ *   transitions & the Rabin pairs whose right side is not empty
+ */
+static void WriteRabinBinaryStart(OutputBuffer &out,
+    const char *input_file_name, const RabinAutomaton &rabin, bool with_trees) {
+
+    int num_states = rabin.GetNumStates();
+    int alphabet_size = rabin.GetAlphabetSize();
+    int num_words = rabin.GetNumStateWords();
+
+    int num_pairs = 0;
+    for (int i = 0; i < rabin.GetNumLabels(); i++) {
+        if (!rabin.IsRightEmpty(i)) { num_pairs++; }
+    }
+
+    uint64_t name_length = strlen(input_file_name);
+    uint64_t transitions_length = (uint64_t) num_states * alphabet_size * 4;
+
+    RabinBinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RABIN_BINARY_MAGIC, 8);
+    header.version = RABIN_BINARY_VERSION;
+    header.flags = (with_trees ? RABIN_BINARY_HAS_TREES : 0);
+    header.num_states = num_states;
+    header.alphabet_size = alphabet_size;
+    header.initial_state = rabin.GetInitialState();
+    header.num_pairs = num_pairs;
+    header.num_state_words = num_words;
+    header.name_length = name_length;
+    header.transitions_offset = sizeof(header) + name_length +
+        PaddingFor(name_length);
+    header.pairs_offset = header.transitions_offset + transitions_length +
+        PaddingFor(transitions_length);
+    if (with_trees) {
+        header.trees_offset = header.pairs_offset +
+            (uint64_t) num_pairs * 2 * num_words * 8;
+    }
+
+    out.Write((const char *) &header, sizeof(header));
+    out.Write(input_file_name, name_length);
+    WritePadding(out);
+
+    // The dense table is already in the file's layout
+    if (transitions_length > 0) {
+        out.Write((const char *) rabin.GetSuccessors(0), transitions_length);
+    }
+    WritePadding(out);
+
+    for (int i = 0; i < rabin.GetNumLabels(); i++) {
+        if (!rabin.IsRightEmpty(i)) {
+            out.Write((const char *) rabin.GetLeft(i), (size_t) num_words * 8);
+            out.Write((const char *) rabin.GetRight(i), (size_t) num_words * 8);
+        }
+    }
+}
+
+/*
+ * Writes what follows the tree text: the padding, the offsets of the trees
+ *   (if any) & the end magic
+ */
+static void WriteRabinBinaryEnd(OutputBuffer &out,
+    const std::vector<uint64_t> &tree_offsets) {
+
+    WritePadding(out);
+    if (!tree_offsets.empty()) {
+        out.Write((const char *) &tree_offsets[0], tree_offsets.size() * 8);
+    }
+    out.Write(RABIN_BINARY_END_MAGIC, 8);
+}
+
+void WriteRabinBinary(OutputBuffer &out, const char *input_file_name,
+    const RabinAutomaton &rabin, const std::vector<std::string> *trees) {
+
+    WriteRabinBinaryStart(out, input_file_name, rabin, trees != NULL);
+
+    std::vector<uint64_t> tree_offsets;
+    if (trees != NULL) {
+        uint64_t offset = 0;
+        tree_offsets.push_back(offset);
+
+        for (int state = 0; state < rabin.GetNumStates(); state++) {
+            out.Write((*trees)[state]);
+            offset += (*trees)[state].size();
+            tree_offsets.push_back(offset);
+        }
+    }
+
+    WriteRabinBinaryEnd(out, tree_offsets);
+}
+
+/*
+ * Trees are rendered straight into the buffer, as in WriteRabin, & their
+ *   offsets read off the buffer's position
+ */
+template <int W>
+void WriteRabinBinary(OutputBuffer &out,
+    const char *input_file_name,
+    const RabinAutomaton &rabin,
+    SafraExplorer<W> &explorer,
+    const std::vector<int> *tree_states,
+    bool with_trees) {
+
+    WriteRabinBinaryStart(out, input_file_name, rabin, with_trees);
+
+    std::vector<uint64_t> tree_offsets;
+    if (with_trees) {
+        uint64_t start = out.GetPosition();
+        tree_offsets.reserve((size_t) rabin.GetNumStates() + 1);
+        tree_offsets.push_back(0);
+
+        for (int id = 0; id < rabin.GetNumStates(); id++) {
+            explorer.WriteTree(tree_states != NULL ? (*tree_states)[id] : id,
+                out);
+            tree_offsets.push_back(out.GetPosition() - start);
+        }
+    }
+
+    WriteRabinBinaryEnd(out, tree_offsets);
+}
+
+
+// ========================================================================== //
+// ================================ Reading ================================= //
+// ========================================================================== //
+
+bool IsRabinBinary(const char *data, const size_t &size) {
+    return size >= 8 && memcmp(data, RABIN_BINARY_MAGIC, 8) == 0;
+}
+
+RabinBinaryFile::RabinBinaryFile() {
+    memset(&header_, 0, sizeof(header_));
+    transitions_ = NULL;
+    pairs_ = NULL;
+    tree_text_ = NULL;
+    tree_offsets_ = NULL;
+}
+
+/*
+ * Checks that every section lies where the header's counts put it & within
+ *   the file, and that every successor & tree offset is in range, so the
+ *   accessors can index the mapping without further checks
+ */
+bool RabinBinaryFile::Open(const char *file_name, std::string &error) {
+
+    if (!file_.Open(file_name)) {
+        error = std::string("cannot read ") + file_name;
+        return false;
+    }
+
+    const char *data = file_.GetData();
+    uint64_t size = file_.GetSize();
+
+    if (!IsRabinBinary(data, size)) {
+        error = std::string(file_name) + " is not a binary Rabin file";
+        return false;
+    }
+
+    std::string corrupt = std::string(file_name) + " is truncated or corrupt";
+    if (size < sizeof(header_) + 8 || size % 8 != 0) {
+        error = corrupt;
+        return false;
+    }
+    memcpy(&header_, data, sizeof(header_));
+
+    if (header_.version != RABIN_BINARY_VERSION) {
+        error = std::string(file_name) + " has unsupported format version " +
+            std::to_string(header_.version);
+        return false;
+    }
+
+    uint64_t num_states = header_.num_states;
+    uint64_t alphabet_size = header_.alphabet_size;
+    uint64_t num_words = header_.num_state_words;
+
+    // Every count must fit in an int & every section in the file (the
+    //   products cannot overflow once their factors are bounded by the size)
+    if (num_states == 0 || num_states > INT32_MAX ||
+        alphabet_size > INT32_MAX || header_.num_pairs > INT32_MAX ||
+        num_words != (num_states + 63) / 64 ||
+        header_.initial_state >= num_states ||
+        (header_.flags & ~(uint32_t) RABIN_BINARY_HAS_TREES) != 0 ||
+        header_.name_length > size || alphabet_size > size ||
+        num_states * alphabet_size > size / 4 ||
+        (uint64_t) header_.num_pairs * num_words > size / 16) {
+        error = corrupt;
+        return false;
+    }
+
+    uint64_t transitions_offset = sizeof(header_) + header_.name_length +
+        PaddingFor(header_.name_length);
+    uint64_t transitions_length = num_states * alphabet_size * 4;
+    uint64_t pairs_offset = transitions_offset + transitions_length +
+        PaddingFor(transitions_length);
+    uint64_t pairs_end = pairs_offset +
+        (uint64_t) header_.num_pairs * 2 * num_words * 8;
+
+    if (header_.transitions_offset != transitions_offset ||
+        header_.pairs_offset != pairs_offset || pairs_end + 8 > size ||
+        memcmp(data + size - 8, RABIN_BINARY_END_MAGIC, 8) != 0) {
+        error = corrupt;
+        return false;
+    }
+
+    transitions_ = (const uint32_t *) (data + transitions_offset);
+    pairs_ = (const uint64_t *) (data + pairs_offset);
+
+    if (HasTrees()) {
+        // The offsets end right before the end magic
+        if (header_.trees_offset != pairs_end ||
+            (num_states + 1) * 8 > size - 8 - pairs_end) {
+            error = corrupt;
+            return false;
+        }
+
+        uint64_t index_offset = size - 8 - (num_states + 1) * 8;
+        tree_text_ = data + pairs_end;
+        tree_offsets_ = (const uint64_t *) (data + index_offset);
+
+        uint64_t text_length = tree_offsets_[num_states];
+        if (tree_offsets_[0] != 0 || text_length > index_offset - pairs_end ||
+            pairs_end + text_length + PaddingFor(text_length) != index_offset) {
+            error = corrupt;
+            return false;
+        }
+        for (uint64_t state = 0; state < num_states; state++) {
+            if (tree_offsets_[state] > tree_offsets_[state + 1]) {
+                error = corrupt;
+                return false;
+            }
+        }
+    }
+    else if (header_.trees_offset != 0 || pairs_end + 8 != size) {
+        error = corrupt;
+        return false;
+    }
+
+    for (uint64_t i = 0; i < num_states * alphabet_size; i++) {
+        if (transitions_[i] >= num_states) {
+            error = corrupt;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int RabinBinaryFile::GetNumStates() const {
+    return header_.num_states;
+}
+
+int RabinBinaryFile::GetAlphabetSize() const {
+    return header_.alphabet_size;
+}
+
+int RabinBinaryFile::GetInitialState() const {
+    return header_.initial_state;
+}
+
+int RabinBinaryFile::GetNumPairs() const {
+    return header_.num_pairs;
+}
+
+int RabinBinaryFile::GetNumStateWords() const {
+    return header_.num_state_words;
+}
+
+bool RabinBinaryFile::HasTrees() const {
+    return (header_.flags & RABIN_BINARY_HAS_TREES) != 0;
+}
+
+std::string RabinBinaryFile::GetInputFileName() const {
+    return std::string(file_.GetData() + sizeof(header_), header_.name_length);
+}
+
+
+// Explicit instantiations for every supported state set width
+#define INSTANTIATE_WRITE_RABIN_BINARY(W) template void WriteRabinBinary<W>(   \
+    OutputBuffer &, const char *, const RabinAutomaton &, SafraExplorer<W> &,  \
+    const std::vector<int> *, bool);
+SAFRA_FOR_EACH_WIDTH(INSTANTIATE_WRITE_RABIN_BINARY)
+#undef INSTANTIATE_WRITE_RABIN_BINARY
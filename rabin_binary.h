@@ -0,0 +1,157 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *     rabin_binary.h - binary (mmap-able) file format for Rabin automata     *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "buechi_reader.h"
+#include "output_buffer.h"
+#include "rabin_automaton.h"
+#include "safra_explorer.h"
+
+// The file is read by casting the mapped bytes, so it is only defined for
+//   little-endian hosts
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The binary Rabin format needs a little-endian host"
+#endif
+
+// First & last 8 bytes of a binary Rabin file, & the version of its layout
+#define RABIN_BINARY_MAGIC "SAFRARAB"
+#define RABIN_BINARY_END_MAGIC "RABINEND"
+#define RABIN_BINARY_VERSION 1
+
+// Header flag: the file holds the Safra tree of every state
+#define RABIN_BINARY_HAS_TREES 1
+
+/*
+ * Layout of a binary Rabin file (all integers little-endian; every section
+ *   starts at a multiple of 8 bytes, so it can be used in place once mapped):
+ *
+ *   header             the RabinBinaryHeader below
+ *   input file name    name_length bytes (no terminator), zero-padded
+ *   transitions        num_states * alphabet_size uint32 successors,
+ *                      state-major (as RabinAutomaton), zero-padded
+ *   Rabin pairs        num_pairs * 2 * num_state_words uint64 words: L, then
+ *                      R of each pair, as bitvectors over the states (state i
+ *                      is bit i % 64 of word i / 64). Only pairs whose R is
+ *                      not empty are stored, as in the text format.
+ *   trees (optional)   the text of every state's Safra tree, e.g.
+ *                      "(1:{1,2}; 2:{2}!)", one after another & zero-padded,
+ *                      followed by num_states + 1 uint64 offsets: tree i is
+ *                      bytes [offset i, offset i+1) of the text
+ *   end magic          RABIN_BINARY_END_MAGIC
+ *
+ * The tree offsets come last so that a writer can stream the trees without
+ *   knowing their lengths in advance; a reader finds them from the end of
+ *   the file.
+ */
+struct RabinBinaryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t num_states;
+    uint32_t alphabet_size;
+    uint32_t initial_state;
+    uint32_t num_pairs;
+    uint32_t num_state_words;
+    uint32_t name_length;
+    uint64_t transitions_offset;
+    uint64_t pairs_offset;
+    uint64_t trees_offset;          // 0 without RABIN_BINARY_HAS_TREES
+};
+
+static_assert(sizeof(RabinBinaryHeader) == 64, "binary Rabin header layout");
+
+/*
+ * Writes rabin to out in the binary format, with the Safra tree of every
+ *   state if trees is not NULL (trees[state] is the text of state's tree, as
+ *   in SafraResult::safra_trees).
+ */
+void WriteRabinBinary(OutputBuffer &out, const char *input_file_name,
+    const RabinAutomaton &rabin, const std::vector<std::string> *trees);
+
+/*
+ * Same as WriteRabin, in the binary format: with_trees adds the tree of
+ *   explorer's state tree_states[state] (or of state itself if tree_states is
+ *   NULL) for every state.
+ */
+template <int W>
+void WriteRabinBinary(OutputBuffer &out,
+    const char *input_file_name,
+    const RabinAutomaton &rabin,
+    SafraExplorer<W> &explorer,
+    const std::vector<int> *tree_states,
+    bool with_trees);
+
+/*
+ * A binary Rabin file, mapped read-only & used in place: nothing but the
+ *   header is copied, and the accessors point into the mapping, which stays
+ *   valid until the RabinBinaryFile is destroyed.
+ */
+class RabinBinaryFile {
+public:
+
+    RabinBinaryFile();
+
+    // Maps & checks the named file. Returns false, with a description in
+    //   error, if it cannot be read or is not a well-formed binary Rabin file.
+    bool Open(const char *file_name, std::string &error);
+
+    int GetNumStates() const;
+    int GetAlphabetSize() const;
+    int GetInitialState() const;
+    int GetNumPairs() const;
+    int GetNumStateWords() const;
+    bool HasTrees() const;
+    std::string GetInputFileName() const;
+
+    uint32_t GetSuccessor(const int &state, const int &character) const {
+        return transitions_[(size_t) state * header_.alphabet_size + character];
+    }
+
+    // The |Sigma| successors of state, indexed by character
+    const uint32_t *GetSuccessors(const int &state) const {
+        return &transitions_[(size_t) state * header_.alphabet_size];
+    }
+
+    // Sides of the i-th stored Rabin pair, GetNumStateWords() words each
+    const uint64_t *GetLeft(const int &pair) const {
+        return &pairs_[(size_t) pair * 2 * header_.num_state_words];
+    }
+
+    const uint64_t *GetRight(const int &pair) const {
+        return GetLeft(pair) + header_.num_state_words;
+    }
+
+    // Text of state's Safra tree (not terminated), if HasTrees()
+    const char *GetTree(const int &state, size_t &length) const {
+        length = tree_offsets_[state + 1] - tree_offsets_[state];
+        return tree_text_ + tree_offsets_[state];
+    }
+
+private:
+    RabinBinaryFile(const RabinBinaryFile &);
+    RabinBinaryFile &operator=(const RabinBinaryFile &);
+
+    MappedFile file_;
+    RabinBinaryHeader header_;
+
+    const uint32_t *transitions_;
+    const uint64_t *pairs_;
+    const char *tree_text_;
+    const uint64_t *tree_offsets_;
+};
+
+// Whether data[0 .. size) starts like a binary Rabin file
+bool IsRabinBinary(const char *data, const size_t &size);
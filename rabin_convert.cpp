@@ -0,0 +1,145 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *   rabin_convert.cpp - converts Rabin automata between text & binary form   *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <string.h>
+
+#include "buechi_reader.h"
+#include "output_buffer.h"
+#include "rabin_automaton.h"
+#include "rabin_binary.h"
+#include "rabin_reader.h"
+#include "rabin_writer.h"
+
+/*
+ * Writes the binary Rabin file to out in the text format of WriteRabin
+ *   (with an empty list of Safra trees if the file holds none)
+ */
+static void WriteBinaryAsText(const RabinBinaryFile &rabin, OutputBuffer &out) {
+
+    int num_states = rabin.GetNumStates();
+    int alphabet_size = rabin.GetAlphabetSize();
+
+    WriteRabinHeader(out, rabin.GetInputFileName().c_str(), num_states,
+        alphabet_size);
+
+    for (int state = 0; state < num_states; state++) {
+        WriteRabinTransitions(out, state, rabin.GetSuccessors(state),
+            alphabet_size);
+    }
+
+    WriteRabinInitialState(out, rabin.GetInitialState());
+
+    for (int i = 0; i < rabin.GetNumPairs(); i++) {
+        WriteRabinPair(out, rabin.GetLeft(i), rabin.GetRight(i),
+            rabin.GetNumStateWords());
+    }
+
+    out.WriteLine(END_RABIN_PAIRS_TAG);
+    out.WriteLine(BEGIN_SAFRA_TREES_TAG);
+
+    if (rabin.HasTrees()) {
+        for (int state = 0; state < num_states; state++) {
+            size_t length;
+            const char *tree = rabin.GetTree(state, length);
+
+            out.WriteInt(state+1);
+            out.Write(": ", 2);
+            out.Write(tree, length);
+            out.WriteChar('\n');
+        }
+    }
+
+    out.WriteLine(END_SAFRA_TREES_TAG);
+    out.WriteLine(RABIN_EOF_TAG);
+}
+
+
+int main(int argc, const char *argv[]) {
+
+    bool with_trees = true;
+    std::vector<const char *> file_names;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--no-trees")) {
+            with_trees = false;
+        }
+        else {
+            file_names.push_back(argv[i]);
+        }
+    }
+
+    if (file_names.size() != 2) {
+        std::cout << "Usage: ./rabin_convert [--no-trees] <inputfile> ";
+        std::cout << "<outputfile>  converts a text Rabin file (the output of ";
+        std::cout << "./safra) to the binary format, or a binary one back to ";
+        std::cout << "text; --no-trees leaves the Safra trees out of a binary ";
+        std::cout << "file (format in info.txt)" << std::endl;
+        return 1;
+    }
+
+    const char *input_file_name = file_names[0];
+    const char *output_file_name = file_names[1];
+
+    // A binary input is read in place while the output is written
+    if (!strcmp(input_file_name, output_file_name)) {
+        std::cout << "ERROR: The input & output files must differ.";
+        std::cout << std::endl;
+        return 1;
+    }
+
+    MappedFile infile;
+    if (!infile.Open(input_file_name)) {
+        std::cout << "ERROR: Improper input filename." << std::endl;
+        return 1;
+    }
+
+    bool to_text = IsRabinBinary(infile.GetData(), infile.GetSize());
+
+    RabinBinaryFile binary;
+    RabinAutomaton rabin;
+    std::string buechi_file_name;
+    std::vector<std::string> trees;
+    std::string error;
+
+    if (to_text ? !binary.Open(input_file_name, error) :
+        !ParseRabin(infile.GetData(), infile.GetSize(), rabin, buechi_file_name,
+            trees, error)) {
+        std::cout << "ERROR: Improperly formatted input file (" << error;
+        std::cout << ")." << std::endl;
+        return 1;
+    }
+
+    OutputBuffer outfile;
+    if (!outfile.Open(output_file_name)) {
+        std::cout << "ERROR: Improper output filename." << std::endl;
+        return 1;
+    }
+
+    if (to_text) {
+        WriteBinaryAsText(binary, outfile);
+    }
+    else {
+        WriteRabinBinary(outfile, buechi_file_name.c_str(), rabin,
+            with_trees && !trees.empty() ? &trees : NULL);
+    }
+
+    if (!outfile.Close()) {
+        std::cout << "ERROR: Could not write output file." << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << (to_text ? "text" : "binary") << " Rabin file ";
+    std::cout << output_file_name << "." << std::endl;
+    return 0;
+}
@@ -0,0 +1,286 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *    rabin_minimizer.cpp - merges equivalent states of a Rabin automaton     *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include <cstdint>
+#include <cassert>
+#include <vector>
+
+#include "state_set.h"
+#include "rabin_minimizer.h"
+
+/*
+ * A partition of the states 0..N-1 into blocks. The states of block b are
+ *   elements[first[b] .. end[b]), and the states marked since the last Split
+ *   are moved to the front of that range, up to mid[b]. Splitting a block
+ *   then only has to relabel its marked states.
+ */
+struct Partition {
+    std::vector<uint32_t> elements;
+    std::vector<uint32_t> location;    // position of each state in elements
+    std::vector<uint32_t> block_of;
+
+    std::vector<uint32_t> first;
+    std::vector<uint32_t> end;
+    std::vector<uint32_t> mid;
+
+    // Blocks with at least one marked state
+    std::vector<uint32_t> touched;
+
+    Partition(const int &num_states) {
+        elements = std::vector<uint32_t>(num_states);
+        location = std::vector<uint32_t>(num_states);
+        block_of = std::vector<uint32_t>(num_states, 0);
+
+        for (int state = 0; state < num_states; state++) {
+            elements[state] = state;
+            location[state] = state;
+        }
+
+        first.push_back(0);
+        end.push_back(num_states);
+        mid.push_back(0);
+    }
+
+    int GetNumBlocks() const {
+        return first.size();
+    }
+
+    int GetSize(const uint32_t &block) const {
+        return end[block] - first[block];
+    }
+
+    void Mark(const uint32_t &state) {
+        uint32_t block = block_of[state];
+        uint32_t i = location[state];
+        if (i < mid[block]) {
+            return;
+        }
+        if (mid[block] == first[block]) {
+            touched.push_back(block);
+        }
+
+        // Swap state with the first unmarked state of its block
+        uint32_t j = mid[block]++;
+        uint32_t other = elements[j];
+        elements[i] = other;
+        location[other] = i;
+        elements[j] = state;
+        location[state] = j;
+    }
+
+    /*
+     * Splits every touched block that is not wholly marked: its marked states
+     *   become a new block. Returns the number of blocks before the split, so
+     *   the new ones are [returned value, GetNumBlocks()), & split_from[i] is
+     *   the block the i-th of them came out of.
+     */
+    int Split(std::vector<uint32_t> &split_from) {
+
+        int num_blocks = GetNumBlocks();
+        split_from.clear();
+
+        for (uint32_t block : touched) {
+            if (mid[block] == end[block]) {
+                mid[block] = first[block];
+                continue;
+            }
+
+            uint32_t new_block = GetNumBlocks();
+            first.push_back(first[block]);
+            end.push_back(mid[block]);
+            mid.push_back(first[block]);
+
+            for (uint32_t i = first[block]; i < mid[block]; i++) {
+                block_of[elements[i]] = new_block;
+            }
+            first[block] = mid[block];
+            split_from.push_back(block);
+        }
+
+        touched.clear();
+        return num_blocks;
+    }
+};
+
+
+static bool Contains(const uint64_t *states, const int &state) {
+    return (states[state / 64] >> (state % 64)) & 1;
+}
+
+/*
+ * Separates the states of a set from the other states of their blocks
+ */
+static void SplitBySet(Partition &partition, const uint64_t *states,
+    const int &num_words, std::vector<uint32_t> &split_from) {
+
+    for (int w = 0; w < num_words; w++) {
+        uint64_t word = states[w];
+        while (word != 0) {
+            partition.Mark(w * 64 + LowestBit(word));
+            word &= word - 1;
+        }
+    }
+    partition.Split(split_from);
+}
+
+
+RabinAutomaton MinimizeRabin(const RabinAutomaton &rabin,
+    std::vector<int> &representatives) {
+
+    int num_states = rabin.GetNumStates();
+    int alphabet_size = rabin.GetAlphabetSize();
+    int num_labels = rabin.GetNumLabels();
+
+    // Predecessors along each letter, grouped by target state:
+    //   predecessors[c][offsets[c][t] .. offsets[c][t+1]) lead to t along c
+    std::vector<std::vector<uint32_t>> offsets(alphabet_size,
+        std::vector<uint32_t>(num_states + 1, 0));
+    std::vector<std::vector<uint32_t>> predecessors(alphabet_size,
+        std::vector<uint32_t>(num_states));
+
+    for (int state = 0; state < num_states; state++) {
+        const uint32_t *successors = rabin.GetSuccessors(state);
+        for (int c = 0; c < alphabet_size; c++) {
+            offsets[c][successors[c] + 1]++;
+        }
+    }
+    for (int c = 0; c < alphabet_size; c++) {
+        for (int t = 0; t < num_states; t++) {
+            offsets[c][t + 1] += offsets[c][t];
+        }
+    }
+    {
+        std::vector<uint32_t> next(num_states);
+        for (int c = 0; c < alphabet_size; c++) {
+            for (int t = 0; t < num_states; t++) {
+                next[t] = offsets[c][t];
+            }
+            for (int state = 0; state < num_states; state++) {
+                predecessors[c][next[rabin.GetSuccessor(state, c)]++] = state;
+            }
+        }
+    }
+
+    std::vector<bool> can_accept(num_labels);
+    for (int label = 0; label < num_labels; label++) {
+        can_accept[label] = !rabin.IsRightEmpty(label);
+    }
+
+    // Start from the blocks of states that agree on every pair that can accept
+    Partition partition(num_states);
+    std::vector<uint32_t> split_from;
+
+    for (int label = 0; label < num_labels; label++) {
+        if (can_accept[label]) {
+            SplitBySet(partition, rabin.GetLeft(label),
+                rabin.GetNumStateWords(), split_from);
+            SplitBySet(partition, rabin.GetRight(label),
+                rabin.GetNumStateWords(), split_from);
+        }
+    }
+
+    // Hopcroft's algorithm: every block in the worklist is used as a splitter
+    //   along every letter. When a block splits, only the smaller half needs
+    //   to become a splitter, unless the block was waiting already.
+    std::vector<uint32_t> worklist;
+    std::vector<bool> in_worklist(partition.GetNumBlocks(), true);
+    for (int block = 0; block < partition.GetNumBlocks(); block++) {
+        worklist.push_back(block);
+    }
+
+    std::vector<uint32_t> splitter;
+
+    while (!worklist.empty()) {
+        uint32_t block = worklist.back();
+        worklist.pop_back();
+        in_worklist[block] = false;
+
+        // Copied, since marking reorders the elements of this block too
+        splitter.assign(&partition.elements[partition.first[block]],
+            &partition.elements[0] + partition.end[block]);
+
+        for (int c = 0; c < alphabet_size; c++) {
+            for (uint32_t target : splitter) {
+                for (uint32_t i = offsets[c][target];
+                    i < offsets[c][target + 1]; i++) {
+                    partition.Mark(predecessors[c][i]);
+                }
+            }
+
+            int first_new = partition.Split(split_from);
+            in_worklist.resize(partition.GetNumBlocks(), false);
+
+            for (size_t i = 0; i < split_from.size(); i++) {
+                uint32_t old_block = split_from[i];
+                uint32_t new_block = first_new + i;
+
+                if (in_worklist[old_block] ||
+                    partition.GetSize(new_block) <= partition.GetSize(old_block)) {
+                    worklist.push_back(new_block);
+                    in_worklist[new_block] = true;
+                }
+                else {
+                    worklist.push_back(old_block);
+                    in_worklist[old_block] = true;
+                }
+            }
+        }
+    }
+
+    // Number the blocks in BFS order from the initial state's block
+    int num_blocks = partition.GetNumBlocks();
+    std::vector<int> state_of(num_blocks, -1);
+    std::vector<uint32_t> order;
+    order.reserve(num_blocks);
+
+    representatives = std::vector<int>(num_blocks);
+    std::vector<int> lowest(num_blocks, num_states);
+    for (int state = num_states - 1; state >= 0; state--) {
+        lowest[partition.block_of[state]] = state;
+    }
+
+    uint32_t initial = partition.block_of[rabin.GetInitialState()];
+    state_of[initial] = 0;
+    order.push_back(initial);
+
+    RabinAutomaton minimized(num_blocks, alphabet_size, num_labels);
+
+    for (size_t state = 0; state < order.size(); state++) {
+        int representative = lowest[order[state]];
+        representatives[state] = representative;
+
+        const uint32_t *successors = rabin.GetSuccessors(representative);
+        for (int c = 0; c < alphabet_size; c++) {
+            uint32_t post = partition.block_of[successors[c]];
+            if (state_of[post] == -1) {
+                state_of[post] = order.size();
+                order.push_back(post);
+            }
+            minimized.SetSuccessor(state, c, state_of[post]);
+        }
+
+        for (int label = 0; label < num_labels; label++) {
+            if (!can_accept[label]) {
+                continue;
+            }
+            if (Contains(rabin.GetLeft(label), representative)) {
+                minimized.AddToLeft(label, state);
+            }
+            if (Contains(rabin.GetRight(label), representative)) {
+                minimized.AddToRight(label, state);
+            }
+        }
+    }
+
+    // Every state of rabin is reachable, so every block is
+    assert((int) order.size() == num_blocks);
+
+    return minimized;
+}
@@ -0,0 +1,31 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *     rabin_minimizer.h - merges equivalent states of a Rabin automaton      *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <vector>
+
+#include "rabin_automaton.h"
+
+/*
+ * Returns the quotient of rabin by the coarsest partition in which states of
+ *   one block belong to exactly the same sides of every Rabin pair and, along
+ *   every letter, move to the same block. Merging such states leaves the
+ *   accepted language unchanged. Pairs with an empty right side can never
+ *   accept, so they do not separate states and are left empty.
+ *
+ * The partition is found with Hopcroft's algorithm in O(N |Sigma| log N)
+ *   time. The merged states are numbered in BFS order from the initial state
+ *   (letters in increasing order), like the states of rabin, and
+ *   representatives[state] is set to the lowest state of rabin merged into
+ *   state.
+ */
+RabinAutomaton MinimizeRabin(const RabinAutomaton &rabin,
+    std::vector<int> &representatives);
@@ -0,0 +1,267 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *     rabin_reader.cpp - parser for the text output of Safra's algorithm     *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include <cstdint>
+#include <cstring>
+
+#include "buechi_reader.h"
+#include "line_scanner.h"
+#include "rabin_reader.h"
+#include "rabin_writer.h"
+#include "state_set.h"
+
+namespace {
+
+/*
+ * Skips [p, end) past prefix, returning false (leaving p untouched) if the
+ *   text does not start with it
+ */
+bool SkipPrefix(const char *&p, const char *end, const char *prefix) {
+    size_t length = strlen(prefix);
+    if ((size_t) (end - p) < length || memcmp(p, prefix, length) != 0) {
+        return false;
+    }
+    p += length;
+    return true;
+}
+
+/*
+ * Reads the 1-indexed states of a "{ 1 2 3 }" set (whose "{" has been
+ *   skipped) into the bitvector set, & skips p past the "}"
+ */
+bool ScanStateSet(const char *&p, const char *end, const int &num_states,
+    uint64_t *set) {
+
+    while (true) {
+        while (p != end && *p == ' ') {
+            p++;
+        }
+        if (p != end && *p == '}') {
+            p++;
+            return true;
+        }
+
+        int state;
+        if (!ScanInt(p, end, state) || state < 1 || state > num_states) {
+            return false;
+        }
+        set[(state - 1) / 64] |= uint64_t(1) << ((state - 1) % 64);
+    }
+}
+
+} // namespace
+
+
+/*
+ * The sections are read in the order WriteRabin writes them
+ */
+bool ParseRabin(const char *data, const size_t &size, RabinAutomaton &rabin,
+    std::string &input_file_name, std::vector<std::string> &trees,
+    std::string &error) {
+
+    LineScanner lines(data, size);
+    const char *line = NULL, *line_end = NULL;
+    error.clear();
+
+    // Moves to the next line, which must be tag (if it is not NULL)
+    auto next_line = [&](const char *tag) {
+        if (!lines.NextLine(line, line_end)) {
+            error = "unexpected end of file";
+            return false;
+        }
+        if (tag != NULL && !LineEquals(line, line_end, tag)) {
+            error = std::string("expected \"") + tag + "\"";
+            return false;
+        }
+        return true;
+    };
+
+    // Reads a line holding a single number
+    auto scan_number = [&](const char *tag, long long &value) {
+        if (!next_line(tag) || !next_line(NULL)) {
+            return false;
+        }
+        const char *p = line;
+        if (!ScanInt(p, line_end, value) || p != line_end) {
+            error = std::string("bad number after \"") + tag + "\"";
+            return false;
+        }
+        return true;
+    };
+
+    auto fail = [&]() {
+        error = "line " + std::to_string(lines.GetLineNumber()) + ": " + error;
+        return false;
+    };
+
+    long long num_states, alphabet_size, num_transitions, initial_state;
+
+    if (!next_line("RABIN") || !next_line(RABIN_INFILE_TAG) ||
+        !next_line(NULL)) {
+        return fail();
+    }
+    input_file_name.assign(line, line_end);
+
+    if (!scan_number(NUM_STATES_TAG, num_states) ||
+        !scan_number(ALPHABET_SIZE_TAG, alphabet_size) ||
+        !scan_number(NUM_TRANSITIONS_TAG, num_transitions)) {
+        return fail();
+    }
+    if (num_states < 1 || num_states > INT32_MAX || alphabet_size < 0 ||
+        alphabet_size > INT32_MAX ||
+        num_transitions != num_states * alphabet_size) {
+        error = "bad numbers of states, letters or transitions";
+        return fail();
+    }
+
+    // ============================ Transitions ============================= //
+
+    if (!next_line(BEGIN_TRANSITIONS_TAG)) {
+        return fail();
+    }
+
+    // Successors, with UINT32_MAX for the ones not read yet
+    std::vector<uint32_t> transitions(num_transitions, UINT32_MAX);
+    long long transition_count = 0;
+
+    while (next_line(NULL) &&
+        !LineEquals(line, line_end, END_TRANSITIONS_TAG)) {
+        const char *p = line;
+        int pre_state = -1, character = -1, post_state = -1;
+
+        if (!ScanInt(p, line_end, pre_state) ||
+            !ScanInt(p, line_end, character) ||
+            !ScanInt(p, line_end, post_state) ||
+            pre_state < 1 || pre_state > num_states ||
+            character < 1 || character > alphabet_size ||
+            post_state < 1 || post_state > num_states) {
+            error = "bad transition";
+            return fail();
+        }
+
+        uint32_t &successor = transitions[(size_t) (pre_state - 1) *
+            alphabet_size + (character - 1)];
+        if (successor != UINT32_MAX) {
+            error = "transition given twice";
+            return fail();
+        }
+        successor = post_state - 1;
+        transition_count++;
+    }
+    if (!error.empty()) {
+        return fail();
+    }
+    if (transition_count != num_transitions) {
+        error = "found " + std::to_string(transition_count) +
+            " transitions, expected " + std::to_string(num_transitions);
+        return fail();
+    }
+
+    if (!scan_number(RABIN_INITIAL_STATE_TAG, initial_state)) {
+        return fail();
+    }
+    if (initial_state != 1) {
+        error = "the initial state must be state 1";
+        return fail();
+    }
+
+    // ============================ Rabin pairs ============================= //
+
+    if (!next_line(BEGIN_RABIN_PAIRS_TAG)) {
+        return fail();
+    }
+
+    // Both sides of every pair, as RabinAutomaton stores them
+    int num_words = ((int) num_states + 63) / 64;
+    std::vector<uint64_t> lefts, rights;
+
+    while (next_line(NULL) &&
+        !LineEquals(line, line_end, END_RABIN_PAIRS_TAG)) {
+        lefts.resize(lefts.size() + num_words, 0);
+        rights.resize(rights.size() + num_words, 0);
+
+        uint64_t *left = &lefts[lefts.size() - num_words];
+        uint64_t *right = &rights[rights.size() - num_words];
+
+        const char *p = line;
+        if (!SkipPrefix(p, line_end, "L={") ||
+            !ScanStateSet(p, line_end, num_states, left) ||
+            !SkipPrefix(p, line_end, ", R={") ||
+            !ScanStateSet(p, line_end, num_states, right) || p != line_end) {
+            error = "bad Rabin pair";
+            return fail();
+        }
+    }
+    if (!error.empty()) {
+        return fail();
+    }
+
+    // ============================ Safra trees ============================= //
+
+    if (!next_line(BEGIN_SAFRA_TREES_TAG)) {
+        return fail();
+    }
+
+    trees.clear();
+    while (next_line(NULL) &&
+        !LineEquals(line, line_end, END_SAFRA_TREES_TAG)) {
+        const char *p = line;
+        int state;
+
+        if (!ScanInt(p, line_end, state) || state != (int) trees.size() + 1 ||
+            state > num_states || !SkipPrefix(p, line_end, ": ")) {
+            error = "bad Safra tree line";
+            return fail();
+        }
+        trees.push_back(std::string(p, line_end));
+    }
+    if (!error.empty()) {
+        return fail();
+    }
+    if (!trees.empty() && (int) trees.size() != num_states) {
+        error = "found " + std::to_string(trees.size()) + " Safra trees, " +
+            "expected " + std::to_string(num_states);
+        return fail();
+    }
+
+    if (!next_line(RABIN_EOF_TAG)) {
+        return fail();
+    }
+
+    // ========================= Build the automaton ======================== //
+
+    int num_pairs = lefts.size() / num_words;
+    rabin = RabinAutomaton(num_states, alphabet_size, num_pairs);
+
+    for (int state = 0; state < num_states; state++) {
+        for (int c = 0; c < alphabet_size; c++) {
+            rabin.SetSuccessor(state, c,
+                transitions[(size_t) state * alphabet_size + c]);
+        }
+    }
+
+    for (int i = 0; i < num_pairs; i++) {
+        for (int w = 0; w < num_words; w++) {
+            uint64_t left = lefts[(size_t) i * num_words + w];
+            uint64_t right = rights[(size_t) i * num_words + w];
+
+            while (left != 0) {
+                rabin.AddToLeft(i, w * 64 + LowestBit(left));
+                left &= left - 1;
+            }
+            while (right != 0) {
+                rabin.AddToRight(i, w * 64 + LowestBit(right));
+                right &= right - 1;
+            }
+        }
+    }
+
+    return true;
+}
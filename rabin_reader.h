@@ -0,0 +1,32 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *       rabin_reader.h - parser for the text output of Safra's algorithm     *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "rabin_automaton.h"
+
+/*
+ * Parses a Rabin automaton file in the text format written by WriteRabin
+ *   (format in info.txt), held in data[0 .. size), into rabin, with one label
+ *   per Rabin pair of the file. input_file_name is set to the file's Buechi
+ *   filename line & trees to the text of each state's Safra tree (empty if
+ *   the file lists no trees).
+ *
+ * Returns false, with error naming the offending line, unless the text is a
+ *   complete Rabin automaton whose initial state is state 1 (as WriteRabin
+ *   always numbers it).
+ */
+bool ParseRabin(const char *data, const size_t &size, RabinAutomaton &rabin,
+    std::string &input_file_name, std::vector<std::string> &trees,
+    std::string &error);
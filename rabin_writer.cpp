@@ -0,0 +1,150 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *   rabin_writer.cpp - writes a Rabin automaton & its Safra trees to a file  *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include "rabin_writer.h"
+
+/*
+ * Writes the (1-indexed) members of a set of Rabin states, each followed by a
+ *   space, in increasing order
+ */
+static void WriteStates(OutputBuffer &out, const uint64_t *states, const int &num_words) {
+    for (int w = 0; w < num_words; w++) {
+        uint64_t word = states[w];
+        while (word != 0) {
+            out.WriteInt((uint64_t) w * 64 + LowestBit(word) + 1);
+            out.WriteChar(' ');
+            word &= word - 1;
+        }
+    }
+}
+
+
+// ======================== Pieces of the output ============================ //
+
+void WriteRabinHeader(OutputBuffer &out, const char *input_file_name,
+    const int &num_states, const int &alphabet_size) {
+
+    out.WriteLine("RABIN");
+    out.WriteLine(RABIN_INFILE_TAG);
+    out.WriteLine(input_file_name);
+
+    out.WriteLine(NUM_STATES_TAG);
+    out.WriteInt(num_states);
+    out.WriteChar('\n');
+
+    out.WriteLine(ALPHABET_SIZE_TAG);
+    out.WriteInt(alphabet_size);
+    out.WriteChar('\n');
+
+    out.WriteLine(NUM_TRANSITIONS_TAG);
+    out.WriteInt((uint64_t) num_states * alphabet_size);
+    out.WriteChar('\n');
+
+    out.WriteLine(BEGIN_TRANSITIONS_TAG);
+}
+
+void WriteRabinTransitions(OutputBuffer &out, const int &state,
+    const uint32_t *successors, const int &alphabet_size) {
+
+    for (int c = 0; c < alphabet_size; c++) {
+        out.WriteInt(state+1);
+        out.Write("  ", 2);
+        out.WriteInt(c+1);
+        out.Write("  ", 2);
+        out.WriteInt(successors[c]+1);
+        out.WriteChar('\n');
+    }
+}
+
+void WriteRabinInitialState(OutputBuffer &out, const int &initial_state) {
+
+    out.WriteLine(END_TRANSITIONS_TAG);
+
+    out.WriteLine(RABIN_INITIAL_STATE_TAG);
+    out.WriteInt(initial_state+1);
+    out.WriteChar('\n');
+
+    out.WriteLine(BEGIN_RABIN_PAIRS_TAG);
+}
+
+void WriteRabinPair(OutputBuffer &out, const uint64_t *left,
+    const uint64_t *right, const int &num_words) {
+
+    out.Write("L={ ");
+
+    // Write every left state
+    WriteStates(out, left, num_words);
+
+    // Insert divider
+    out.Write("}, R={ ");
+
+    // Write every right state
+    WriteStates(out, right, num_words);
+    out.WriteLine("}");
+}
+
+
+// ========================== The whole automaton =========================== //
+
+/*
+ * Writes the contents of the computed Rabin automaton to out. Transitions are
+ *   streamed in state order straight from the dense transition table, and each
+ *   Safra tree is decoded & rendered into the buffer as its line is reached.
+ */
+template <int W>
+void WriteRabin(OutputBuffer &out,
+    const char *input_file_name,
+    const RabinAutomaton &rabin,
+    SafraExplorer<W> &explorer,
+    const std::vector<int> *tree_states) {
+
+    int num_rabin_states = rabin.GetNumStates();
+    int alphabet_size = rabin.GetAlphabetSize();
+
+    WriteRabinHeader(out, input_file_name, num_rabin_states, alphabet_size);
+
+    for (int state = 0; state < num_rabin_states; state++) {
+        WriteRabinTransitions(out, state, rabin.GetSuccessors(state),
+            alphabet_size);
+    }
+
+    WriteRabinInitialState(out, rabin.GetInitialState());
+
+    for (int i = 0; i < rabin.GetNumLabels(); i++) {
+
+        // Only read a new Rabin pair if the right side isn't empty
+        if (!rabin.IsRightEmpty(i)) {
+            WriteRabinPair(out, rabin.GetLeft(i), rabin.GetRight(i),
+                rabin.GetNumStateWords());
+        }
+    }
+
+    out.WriteLine(END_RABIN_PAIRS_TAG);
+    out.WriteLine(BEGIN_SAFRA_TREES_TAG);
+
+    // Trees are only rendered here, in id order
+    for (int id = 0; id < num_rabin_states; id++) {
+        out.WriteInt(id+1);
+        out.Write(": ", 2);
+        explorer.WriteTree(tree_states != NULL ? (*tree_states)[id] : id, out);
+        out.WriteChar('\n');
+    }
+
+    out.WriteLine(END_SAFRA_TREES_TAG);
+    out.WriteLine(RABIN_EOF_TAG);
+}
+
+
+// Explicit instantiations for every supported state set width
+#define INSTANTIATE_WRITE_RABIN(W) template void WriteRabin<W>(OutputBuffer &, \
+    const char *, const RabinAutomaton &, SafraExplorer<W> &,                   \
+    const std::vector<int> *);
+SAFRA_FOR_EACH_WIDTH(INSTANTIATE_WRITE_RABIN)
+#undef INSTANTIATE_WRITE_RABIN
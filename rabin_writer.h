@@ -0,0 +1,56 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *    rabin_writer.h - writes a Rabin automaton & its Safra trees to a file   *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "buechi_reader.h"
+#include "output_buffer.h"
+#include "rabin_automaton.h"
+#include "safra_explorer.h"
+
+// Tag lines of the Rabin output that are not shared with the .aut format
+#define RABIN_INFILE_TAG "# Buechi filename"
+#define RABIN_INITIAL_STATE_TAG "# Rabin initial"
+#define BEGIN_RABIN_PAIRS_TAG "# begin Rabin pairs"
+#define END_RABIN_PAIRS_TAG "# end Rabin pairs"
+#define BEGIN_SAFRA_TREES_TAG "# begin Safra trees"
+#define END_SAFRA_TREES_TAG "# end Safra trees"
+#define RABIN_EOF_TAG "# Rabin eof"
+
+/*
+ * The output in pieces, for writers that stream the automaton from somewhere
+ *   other than a RabinAutomaton (see SpillExplorer). In order: the header up
+ *   to the transitions, the transitions of each state in turn, the initial
+ *   state (closing the transitions & opening the pairs), each Rabin pair
+ *   whose right side is not empty, and then the tags & lines of the trees.
+ *   States are 0-indexed here & written 1-indexed.
+ */
+void WriteRabinHeader(OutputBuffer &out, const char *input_file_name,
+    const int &num_states, const int &alphabet_size);
+void WriteRabinTransitions(OutputBuffer &out, const int &state,
+    const uint32_t *successors, const int &alphabet_size);
+void WriteRabinInitialState(OutputBuffer &out, const int &initial_state);
+void WriteRabinPair(OutputBuffer &out, const uint64_t *left,
+    const uint64_t *right, const int &num_words);
+
+/*
+ * Writes rabin to out in the output format of info.txt, including the Safra
+ *   tree of every state: the tree of explorer's state tree_states[state], or
+ *   of its own state if tree_states is NULL (rabin is explorer's automaton).
+ */
+template <int W>
+void WriteRabin(OutputBuffer &out,
+    const char *input_file_name,
+    const RabinAutomaton &rabin,
+    SafraExplorer<W> &explorer,
+    const std::vector<int> *tree_states);
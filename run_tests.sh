@@ -1,8 +1,33 @@
 #!/bin/bash
 
-# Set up environment, make sure code is compiled
+# Set up environment, make sure code & test programs are compiled
 make
-mkdir test_results
+make tests
+mkdir -p test_results
+
+# Number of checks below that did not give the expected result
+failures=0
+
+# check NAME EXPECTEDFILE RESULTFILE : the result must match byte for byte
+check() {
+    if cmp -s "$2" "$3"; then
+        echo "PASS: $1"
+    else
+        echo "FAIL: $1 ($3 differs from $2)"
+        failures=$((failures + 1))
+    fi
+}
+
+# check_states NAME COUNT RESULTFILE : the result must have COUNT states
+check_states() {
+    states=$(sed -n '/^# Number of states$/{n;p;q}' "$3")
+    if [ "$states" = "$2" ]; then
+        echo "PASS: $1 ($2 states)"
+    else
+        echo "FAIL: $1 ($3 has ${states:-no} states instead of $2)"
+        failures=$((failures + 1))
+    fi
+}
 
 # Run on basic Buechi test cases
 ./safra test/buechi1.aut test_results/rabin1.txt
@@ -20,4 +45,208 @@ mkdir test_results
 ./safra test/monster4.aut test_results/monsterrabin4.txt
 ./safra test/monster5.aut test_results/monsterrabin5.txt
 
+# Run on automata with more than 64 states (littlemonster3 with its states
+#   spread over 4 and 16 words), also with several threads
+./safra test/wide130.aut test_results/widerabin130.txt
+./safra test/wide1000.aut test_results/widerabin1000.txt
+./safra --threads 4 test/wide1000.aut test_results/widerabin1000threads.txt
+check "130 states" test/expected/wide130.txt test_results/widerabin130.txt
+check "1000 states" test/expected/wide1000.txt test_results/widerabin1000.txt
+check "1000 states, 4 threads" test/expected/wide1000.txt \
+    test_results/widerabin1000threads.txt
+
+# Memory on a wide automaton: the arenas' chunks must not grow with the number
+#   of states (wide1000 has only 21 states, & peaks at about 22 MB on 4 threads)
+for threads in 1 4; do
+    rss=$(./safra --threads $threads --stats-json - test/wide1000.aut \
+        test_results/widerabin1000rss.txt |
+        sed -n 's/.*"peak_rss_kb": *\([0-9]*\).*/\1/p')
+    if [ -n "$rss" ] && [ "$rss" -le 49152 ]; then
+        echo "PASS: 1000 states, $threads thread(s), peak memory $rss KiB"
+    else
+        echo "FAIL: 1000 states, $threads thread(s), peak memory" \
+            "${rss:-unknown} KiB (over 48 MiB)"
+        failures=$((failures + 1))
+    fi
+done
+
+# Run every test automaton with --canonical (NAME:STATES). buechi2 is not
+#   shrunk: its states 2 & 3 hold the same tree, but state 3's node 2 was
+#   just renamed, so the two stay apart (see info.txt).
+for test in buechi1:2 buechi2:3 buechi3:5 buechi4:6 littlemonster3:21 \
+    littlemonster4:197 littlemonster5:3813 monster3:15 monster4:148 \
+    monster5:2743 wide130:21 wide1000:21; do
+    name=${test%%:*}
+    result=test_results/$name.canonical.txt
+    ./safra --canonical test/$name.aut $result > /dev/null
+    check_states "$name --canonical" ${test##*:} $result
+    if [ -f test/expected/$name.canonical.txt ]; then
+        check "$name --canonical output" test/expected/$name.canonical.txt \
+            $result
+    fi
+done
+
+# Run every test automaton with --minimize, then with --canonical --minimize
+#   (NAME:EXPLORED:MINIMIZED states, plain & then canonical)
+minimize_tests="buechi1:2:2:2:2 buechi2:3:3:3:3 buechi3:5:4:5:4 \
+    buechi4:6:4:6:4 littlemonster3:21:21:21:21 littlemonster4:257:257:197:197 \
+    littlemonster5:10369:10369:3813:3813 monster3:15:14:15:14 \
+    monster4:188:187:148:147 monster5:7214:7213:2743:2742 \
+    wide130:21:21:21:21 wide1000:21:21:21:21"
+for test in $minimize_tests; do
+    IFS=: read name explored minimized canonical_explored canonical_minimized \
+        <<< "$test"
+
+    for mode in minimize canonical.minimize; do
+        if [ $mode = minimize ]; then
+            options="--minimize"
+            from=$explored
+            to=$minimized
+        else
+            options="--canonical --minimize"
+            from=$canonical_explored
+            to=$canonical_minimized
+        fi
+
+        result=test_results/$name.$mode.txt
+        expected="Minimized the Rabin automaton from $from to $to states."
+        message=$(./safra $options test/$name.aut $result | grep Minimized)
+        if [ "$message" = "$expected" ]; then
+            echo "PASS: $name $options ($from to $to states)"
+        else
+            echo "FAIL: $name $options (${message:-no result})"
+            failures=$((failures + 1))
+        fi
+        check_states "$name $options" $to $result
+        if [ -f test/expected/$name.$mode.txt ]; then
+            check "$name $options output" test/expected/$name.$mode.txt $result
+        fi
+    done
+done
+
+# Run every test automaton with --spill-dir, on a 1 MB budget, which has to
+#   give the same output as the in-memory explorer
+mkdir -p test_results/spill
+for aut in test/*.aut; do
+    name=$(basename $aut .aut)
+    ./safra $aut test_results/$name.txt > /dev/null
+    ./safra --spill-dir test_results/spill --memory-budget 1 $aut \
+        test_results/$name.spill.txt > /dev/null
+    check "$name --spill-dir" test_results/$name.txt test_results/$name.spill.txt
+
+    ./safra --canonical --spill-dir test_results/spill --memory-budget 1 $aut \
+        test_results/$name.canonical.spill.txt > /dev/null
+    check "$name --canonical --spill-dir" test_results/$name.canonical.txt \
+        test_results/$name.canonical.spill.txt
+done
+
+# --checkpoint & --resume. A run whose output file cannot be written keeps its
+#   last checkpoint, which a tiny interval makes the one taken just before
+#   the exploration ends. Resuming from it (on 1 & on 4 threads) has to give
+#   the output of an uninterrupted run, & the checkpoint must not be taken
+#   for another automaton or --canonical setting.
+for name in buechi3 littlemonster4 monster4 wide130; do
+    for options in "" "--canonical"; do
+        checkpoint=test_results/$name.checkpoint
+        mode=$name${options:+.canonical}
+        rm -f $checkpoint
+        ./safra $options --checkpoint $checkpoint --checkpoint-interval 0.000001 \
+            test/$name.aut test_results/missing/$name.txt > /dev/null
+
+        for threads in 1 4; do
+            cp $checkpoint $checkpoint.$threads
+            ./safra $options --threads $threads --checkpoint \
+                $checkpoint.$threads --resume test/$name.aut \
+                test_results/$mode.resumed$threads.txt > /dev/null
+            check "$name ${options:+$options }--resume, $threads thread(s)" \
+                test_results/$mode.txt test_results/$mode.resumed$threads.txt
+        done
+    done
+
+    # The checkpoint left is that of the --canonical run
+    for other in test/monster3.aut test/$name.aut; do
+        cp $checkpoint $checkpoint.other
+        if ./safra --checkpoint $checkpoint.other --resume $other \
+            test_results/$name.other.txt | grep -q "Cannot resume"; then
+            echo "PASS: $name --canonical checkpoint refused for $other"
+        else
+            echo "FAIL: $name --canonical checkpoint resumed for $other"
+            failures=$((failures + 1))
+        fi
+    done
+done
+
+# --binary: the binary output has to convert back to the text output with
+#   rabin_convert & be exactly what rabin_convert makes of the text output
+#   (with & without trees, & after --minimize), & match the expected file in
+#   test/expected where there is one
+for aut in test/*.aut; do
+    name=$(basename $aut .aut)
+    result=test_results/$name
+
+    ./safra --binary $aut $result.bin > /dev/null
+    ./rabin_convert $result.bin $result.bin.txt > /dev/null
+    check "$name --binary to text" $result.txt $result.bin.txt
+    ./rabin_convert $result.txt $result.converted.bin > /dev/null
+    check "$name text to --binary" $result.bin $result.converted.bin
+    if [ -f test/expected/$name.bin ]; then
+        check "$name --binary output" test/expected/$name.bin $result.bin
+    fi
+
+    ./safra --binary --no-trees $aut $result.notrees.bin > /dev/null
+    ./rabin_convert --no-trees $result.txt $result.notrees.converted.bin \
+        > /dev/null
+    check "$name text to --binary --no-trees" $result.notrees.bin \
+        $result.notrees.converted.bin
+
+    ./safra --binary --minimize $aut $result.minimize.bin > /dev/null
+    ./rabin_convert $result.minimize.bin $result.minimize.bin.txt > /dev/null
+    check "$name --binary --minimize to text" $result.minimize.txt \
+        $result.minimize.bin.txt
+done
+
+# HOA input: test/buechi2.hoa is test/buechi2.aut in HOA, so it has to give
+#   the same result (but for the file name), & the other .hoa files (with
+#   aliases, & with generalized acceptance on edges) their expected output
+for hoa in test/*.hoa; do
+    name=$(basename $hoa)
+    ./safra $hoa test_results/$name.txt > /dev/null
+    if [ -f test/expected/$name.txt ]; then
+        check "$name input" test/expected/$name.txt test_results/$name.txt
+    fi
+done
+check "buechi2.hoa input like buechi2.aut" <(tail -n +4 test_results/buechi2.txt) \
+    <(tail -n +4 test_results/buechi2.hoa.txt)
+
+# --hoa output (also with --no-trees & --minimize), from .aut & .hoa inputs,
+#   compared with the expected files in test/expected
+for input in test/*.aut test/*.hoa; do
+    name=$(basename $input)
+    for mode in hoa notrees.hoa minimize.hoa; do
+        if [ -f test/expected/$name.$mode ]; then
+            case $mode in
+                hoa) options="--hoa" ;;
+                notrees.hoa) options="--hoa --no-trees" ;;
+                minimize.hoa) options="--hoa --minimize" ;;
+            esac
+            ./safra $options $input test_results/$name.$mode > /dev/null
+            check "$name $options" test/expected/$name.$mode \
+                test_results/$name.$mode
+        fi
+    done
+done
+
+# Explore LazyRabin in BFS order & compare it with Determinize (successors,
+#   Rabin pairs & trees), with & without canonical labels
+if ./test/lazy_rabin_test test/*.aut test/*.hoa; then
+    echo "PASS: LazyRabin matches Determinize"
+else
+    echo "FAIL: LazyRabin differs from Determinize"
+    failures=$((failures + 1))
+fi
 
+if [ $failures -ne 0 ]; then
+    echo "$failures check(s) failed."
+    exit 1
+fi
+echo "All checks passed."
@@ -0,0 +1,69 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *         safra.cpp - programmatic interface of the libsafra library         *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include "safra.h"
+#include "safra_explorer.h"
+#include "rabin_minimizer.h"
+
+/*
+ * Runs Safra's algorithm with W-word state sets & fills in result
+ */
+template <int W>
+static void DeterminizeWithWidth(const BuchiAutomaton &automaton,
+    const SafraOptions &options, SafraResult &result) {
+
+    SafraExplorer<W> explorer(&automaton, options.num_threads,
+        options.canonical_labels, options.allocator);
+    explorer.Run();
+
+    // states[i] is the explored state whose tree state i shows
+    std::vector<int> states;
+
+    if (options.minimize) {
+        result.rabin = MinimizeRabin(explorer.GetRabinAutomaton(), states);
+    }
+    else {
+        result.rabin = explorer.GetRabinAutomaton();
+        for (int state = 0; state < explorer.GetNumStates(); state++) {
+            states.push_back(state);
+        }
+    }
+
+    result.safra_trees.clear();
+    if (options.keep_trees) {
+        for (int state : states) {
+            result.safra_trees.push_back(explorer.TreeToString(state));
+        }
+    }
+}
+
+
+bool Determinize(const BuchiAutomaton &automaton, const SafraOptions &options,
+    SafraResult &result, std::string &error) {
+
+    if (!options.allocator.IsValid()) {
+        error = "the allocator must set both allocate and deallocate, or neither";
+        return false;
+    }
+
+    switch (automaton.GetNumWords()) {
+#define DETERMINIZE_WITH_WIDTH(W)                                               \
+        case W:                                                                 \
+            DeterminizeWithWidth<W>(automaton, options, result);                \
+            return true;
+        SAFRA_FOR_EACH_WIDTH(DETERMINIZE_WITH_WIDTH)
+#undef DETERMINIZE_WITH_WIDTH
+        default:
+            break;
+    }
+
+    error = "the Buechi automaton has no states";
+    return false;
+}
@@ -0,0 +1,55 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *          safra.h - programmatic interface of the libsafra library          *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "buechi_automaton.h"
+#include "buechi_reader.h"
+#include "rabin_automaton.h"
+#include "safra_allocator.h"
+
+/*
+ * How Determinize runs. A default-constructed SafraOptions gives the same
+ *   automaton as './safra' without any options.
+ */
+struct SafraOptions {
+    int num_threads;            // explorer worker threads
+    bool canonical_labels;      // as --canonical
+    bool minimize;              // as --minimize
+    bool keep_trees;            // fill in SafraResult::safra_trees
+    SafraAllocator allocator;   // for the node arrays of expanded trees
+
+    SafraOptions()
+        : num_threads(1), canonical_labels(false), minimize(false),
+          keep_trees(false) {}
+};
+
+struct SafraResult {
+    RabinAutomaton rabin;
+
+    // safra_trees[state] is the text of state's Safra tree, as in the output
+    //   file (only if options.keep_trees)
+    std::vector<std::string> safra_trees;
+};
+
+/*
+ * Determinizes automaton (built with BuchiAutomaton's methods, or read with
+ *   ParseBuechi) into result, picking the state set width from the number of
+ *   states. Nothing is shared between calls, so any number of them may run
+ *   one after another or on different threads.
+ *
+ * Returns false, with a description in error, if automaton is empty or
+ *   options.allocator sets only one of its hooks.
+ */
+bool Determinize(const BuchiAutomaton &automaton, const SafraOptions &options,
+    SafraResult &result, std::string &error);
@@ -0,0 +1,40 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *     safra_allocator.h - allocation hooks for the Safra tree node storage   *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+
+/*
+ * Hooks through which the node arrays of the Safra trees being worked on (the
+ *   scratch & successor trees of each thread, or of a LazyRabin) are
+ *   allocated, in chunks of about 64 KiB. Explored trees are only kept as
+ *   their encodings in the dedup table, & that table (key pool & slots), the
+ *   transition buffers & the RabinAutomaton, which hold the bulk of the
+ *   memory of a large run, still come from operator new. Both functions
+ *   are passed context as their last argument, and deallocate gets the same
+ *   size that allocate was asked for. allocate must return memory aligned
+ *   for any type, or NULL on failure. Without hooks (the default), chunks
+ *   come from operator new.
+ *
+ * The hooks come as a pair: either both are set or neither is, since memory
+ *   from one allocator must never be handed back to the other. Determinize
+ *   refuses a SafraAllocator with only one hook.
+ */
+struct SafraAllocator {
+    void *(*allocate)(size_t size, void *context);
+    void (*deallocate)(void *memory, size_t size, void *context);
+    void *context;
+
+    SafraAllocator() : allocate(NULL), deallocate(NULL), context(NULL) {}
+
+    // Whether both hooks or neither are set
+    bool IsValid() const { return (allocate == NULL) == (deallocate == NULL); }
+};
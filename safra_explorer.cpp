@@ -0,0 +1,898 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *   safra_explorer.cpp - (parallel) exploration of the reachable Safra trees *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include <algorithm>
+#include <thread>
+#include <queue>
+#include <chrono>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+
+#include "safra_explorer.h"
+#include "buechi_reader.h"
+
+// ===================== Constructor, destructor & Run ====================== //
+
+template <int W>
+SafraExplorer<W>::SafraExplorer(const BuchiAutomaton *automaton,
+    int num_threads, bool canonical_labels, const SafraAllocator &allocator) {
+
+    num_threads_ = (num_threads > 0 ? num_threads : 1);
+    canonical_labels_ = canonical_labels;
+    checkpoint_interval_ = 0;
+
+    for (int t = 0; t < num_threads_; t++) {
+        Worker *worker = new Worker();
+        worker->arena = new SafraArena<W>(2*automaton->GetNumStates(),
+            allocator);
+        worker->scratch_tree = NULL;
+        workers_.push_back(worker);
+    }
+
+    Reset(automaton);
+}
+
+template <int W>
+SafraExplorer<W>::~SafraExplorer() {
+
+    for (Worker *worker : workers_) {
+        // The trees first, since they hand their nodes back to the arena
+        DeleteTrees(worker);
+        delete worker->arena;
+        delete worker;
+    }
+}
+
+template <int W>
+void *SafraExplorer<W>::operator new(size_t size) {
+    void *memory;
+    if (posix_memalign(&memory, alignof(SafraExplorer<W>), size) != 0) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+template <int W>
+void SafraExplorer<W>::operator delete(void *memory) {
+    free(memory);
+}
+
+
+/*
+ * Seeds worker 0 with the initial tree, runs all workers until every queued
+ *   tree has been expanded, and then renumbers the states in BFS order.
+ */
+template <int W>
+void SafraExplorer<W>::Run() {
+
+    std::vector<uint8_t> key;
+    bool inserted;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // After LoadCheckpoint, the restored queues already hold the work
+    if (!resumed_) {
+        SafraTree<W> initial_tree(workers_[0]->arena, automaton_,
+            canonical_labels_);
+        initial_id_ = InsertTree(&initial_tree, key, inserted);
+        workers_[0]->trees_generated++;
+        CountNewTree(workers_[0], &initial_tree);
+
+        PushWork(0, initial_id_);
+    }
+
+    next_checkpoint_ = start +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(checkpoint_interval_));
+
+    if (num_threads_ == 1) {
+        WorkerLoop(0);
+    }
+    else {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads_; t++) {
+            threads.push_back(std::thread(&SafraExplorer<W>::WorkerLoop, this, t));
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+
+    std::chrono::steady_clock::time_point explored = std::chrono::steady_clock::now();
+    Renumber(initial_id_);
+
+    explore_ms_ = std::chrono::duration<double, std::milli>(
+        explored - start).count();
+    renumber_ms_ = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - explored).count();
+}
+
+
+template <int W>
+void SafraExplorer<W>::Reset(const BuchiAutomaton *automaton) {
+
+    for (Stripe &stripe : stripes_) {
+        stripe.table.Clear();
+    }
+
+    automaton_ = automaton;
+    pending_ = 0;
+    explore_ms_ = 0;
+    renumber_ms_ = 0;
+
+    checkpoint_error_.clear();
+    pause_ = false;
+    num_paused_ = 0;
+    num_finished_ = 0;
+    resumed_ = false;
+    initial_id_ = 0;
+
+    for (Worker *worker : workers_) {
+        // The scratch & successor trees belong to the old automaton, & hold
+        //   the only node arrays the arena has handed out
+        DeleteTrees(worker);
+        worker->arena->Reset(2*automaton_->GetNumStates());
+        worker->scratch_tree = new SafraTree<W>(worker->arena, automaton_,
+            canonical_labels_);
+        for (int c = 0; c < automaton_->GetAlphabetSize(); c++) {
+            worker->successor_trees.push_back(new SafraTree<W>(worker->arena,
+                automaton_, canonical_labels_));
+        }
+        worker->deque.clear();
+        worker->sources.clear();
+        worker->successors.clear();
+        worker->label_bits.clear();
+
+        worker->trees_generated = 0;
+        worker->dedup_hits = 0;
+        worker->max_tree_nodes = 0;
+        worker->max_tree_depth = 0;
+        worker->never_used_labels = Labels();
+        for (int i = 0; i < 2*automaton_->GetNumStates(); i++) {
+            worker->never_used_labels.Insert(i);
+        }
+    }
+
+    stripe_offsets_.clear();
+    rabin_ = RabinAutomaton();
+    ids_.clear();
+}
+
+
+// ============================ Access methods ============================== //
+
+template <int W>
+int SafraExplorer<W>::GetNumStates() {
+    return ids_.size();
+}
+
+template <int W>
+const RabinAutomaton &SafraExplorer<W>::GetRabinAutomaton() {
+    return rabin_;
+}
+
+/*
+ * Sums up the workers' & stripes' counters
+ */
+template <int W>
+ExplorerStats SafraExplorer<W>::GetStats() {
+
+    ExplorerStats stats = ExplorerStats();
+    stats.explore_ms = explore_ms_;
+    stats.renumber_ms = renumber_ms_;
+    stats.labels_available = 2*automaton_->GetNumStates();
+
+    Labels never_used_labels = workers_[0]->never_used_labels;
+
+    for (Worker *worker : workers_) {
+        stats.trees_generated += worker->trees_generated;
+        stats.dedup_hits += worker->dedup_hits;
+        stats.max_tree_nodes = std::max(stats.max_tree_nodes,
+            worker->max_tree_nodes);
+        stats.max_tree_depth = std::max(stats.max_tree_depth,
+            worker->max_tree_depth);
+        never_used_labels = Labels::Intersect(never_used_labels,
+            worker->never_used_labels);
+    }
+    stats.dedup_misses = stats.trees_generated - stats.dedup_hits;
+    stats.labels_used = stats.labels_available - never_used_labels.Count();
+
+    for (Stripe &stripe : stripes_) {
+        stats.table_entries += stripe.table.Size();
+        stats.table_slots += stripe.table.GetCapacity();
+        stats.table_lookups += stripe.table.GetNumLookups();
+        stats.table_probes += stripe.table.GetNumProbes();
+        stats.table_max_probe = std::max(stats.table_max_probe,
+            stripe.table.GetMaxProbe());
+    }
+
+    return stats;
+}
+
+template <int W>
+std::string SafraExplorer<W>::TreeToString(const int &state) {
+    DecodeTree(ids_[state], workers_[0]);
+    return workers_[0]->scratch_tree->ToString();
+}
+
+template <int W>
+void SafraExplorer<W>::WriteTree(const int &state, OutputBuffer &out) {
+    DecodeTree(ids_[state], workers_[0]);
+    workers_[0]->scratch_tree->WriteTo(out);
+}
+
+
+// ============================ Worker threads ============================== //
+
+/*
+ * Main loop of worker t: expand trees along every character until no worker
+ *   has any work left.
+ */
+template <int W>
+void SafraExplorer<W>::WorkerLoop(const int &t) {
+
+    Worker *worker = workers_[t];
+    int alphabet_size = automaton_->GetAlphabetSize();
+
+    // Scratch buffer for tree encodings, reused across all trees
+    std::vector<uint8_t> key;
+    bool inserted;
+
+    uint64_t id;
+
+    while (true) {
+
+        if (pause_.load()) {
+            WaitForCheckpoint();
+        }
+        if (t == 0 && !checkpoint_file_name_.empty() &&
+            std::chrono::steady_clock::now() >= next_checkpoint_) {
+            Checkpoint();
+        }
+
+        if (!PopWork(t, id)) {
+            if (pending_.load() == 0) {
+                std::lock_guard<std::mutex> guard(pause_lock_);
+                num_finished_++;
+                pause_changed_.notify_all();
+                return;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+
+        worker->sources.push_back(id);
+
+        // Find the resulting tree for every character in one batch, noting
+        //   the labels the Rabin pairs need while the tree is decoded
+        DecodeTree(id, worker);
+        AddLabelMasks(worker, worker->scratch_tree);
+        worker->scratch_tree->GetSuccessors(worker->successor_trees);
+
+        for (int character = 0; character < alphabet_size; character++) {
+
+            SafraTree<W> *transition_tree = worker->successor_trees[character];
+
+            uint64_t post_id = InsertTree(transition_tree, key, inserted);
+            worker->trees_generated++;
+
+            // If it's new, queue it; either way the table now holds its
+            //   encoding, which is all that is kept of it
+            if (inserted) {
+                CountNewTree(worker, transition_tree);
+                PushWork(t, post_id);
+            }
+            else {
+                worker->dedup_hits++;
+            }
+
+            worker->successors.push_back(post_id);
+        }
+
+        pending_--;
+    }
+}
+
+/*
+ * Updates worker's statistics with a tree that was just added to the table
+ */
+template <int W>
+void SafraExplorer<W>::CountNewTree(Worker *worker, SafraTree<W> *tree) {
+    worker->max_tree_nodes = std::max(worker->max_tree_nodes,
+        tree->GetNumNodes());
+    worker->max_tree_depth = std::max(worker->max_tree_depth, tree->GetDepth());
+    worker->never_used_labels = Labels::Intersect(worker->never_used_labels,
+        tree->GetUnusedLabels());
+}
+
+/*
+ * Records the label masks of tree, the tree worker is expanding (the last
+ *   entry of its sources), for the Rabin pairs: its unused or renamed labels,
+ *   then its marked labels, 2n bits each. A label set is 2W words wide
+ *   whatever n is, so only the bits of labels that exist are kept.
+ */
+template <int W>
+void SafraExplorer<W>::AddLabelMasks(Worker *worker, SafraTree<W> *tree) {
+
+    uint64_t num_labels = 2*automaton_->GetNumStates();
+    uint64_t first_bit = (worker->sources.size() - 1) * 2 * num_labels;
+    worker->label_bits.resize((first_bit + 2 * num_labels + 63) / 64, 0);
+
+    Labels masks[2] = { Labels::Union(tree->GetUnusedLabels(),
+        tree->GetRenamedLabels()), tree->GetMarkedLabels() };
+
+    for (int side = 0; side < 2; side++) {
+        for (int w = 0; w < 2 * W; w++) {
+            uint64_t word = masks[side].GetWord(w);
+            while (word != 0) {
+                uint64_t bit = first_bit + side * num_labels +
+                    w * BITS_PER_WORD + LowestBit(word);
+                worker->label_bits[bit / 64] |= uint64_t(1) << (bit % 64);
+                word &= word - 1;
+            }
+        }
+    }
+}
+
+/*
+ * Takes work for worker t: from the back of its own deque if possible,
+ *   otherwise from the front of another worker's deque.
+ */
+template <int W>
+bool SafraExplorer<W>::PopWork(const int &t, uint64_t &id) {
+
+    {
+        Worker *worker = workers_[t];
+        std::lock_guard<std::mutex> guard(worker->lock);
+        if (!worker->deque.empty()) {
+            id = worker->deque.back();
+            worker->deque.pop_back();
+            return true;
+        }
+    }
+
+    for (int i = 1; i < num_threads_; i++) {
+        Worker *victim = workers_[(t + i) % num_threads_];
+        std::lock_guard<std::mutex> guard(victim->lock);
+        if (!victim->deque.empty()) {
+            id = victim->deque.front();
+            victim->deque.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template <int W>
+void SafraExplorer<W>::PushWork(const int &t, const uint64_t &id) {
+
+    pending_++;
+
+    Worker *worker = workers_[t];
+    std::lock_guard<std::mutex> guard(worker->lock);
+    worker->deque.push_back(id);
+}
+
+/*
+ * Looks tree up in the stripe picked by its hash, adding it if it is new.
+ *   Provisional ids are (index within stripe) * NUM_TABLE_STRIPES + stripe.
+ */
+template <int W>
+uint64_t SafraExplorer<W>::InsertTree(SafraTree<W> *tree,
+    std::vector<uint8_t> &key, bool &inserted) {
+
+    uint64_t hash = tree->Encode(key);
+
+    // The table probes with the low bits of the hash, so stripe by the high ones
+    int s = hash >> (64 - TABLE_STRIPE_BITS);
+    Stripe &stripe = stripes_[s];
+
+    std::lock_guard<std::mutex> guard(stripe.lock);
+    int local_id = stripe.table.Insert(&key[0], key.size(), hash, inserted);
+
+    return ((uint64_t) local_id << TABLE_STRIPE_BITS) | s;
+}
+
+/*
+ * Decodes the tree with provisional id into worker's scratch tree. The
+ *   encoding is copied out under the stripe's lock, since another worker's
+ *   Insert may move the key pool.
+ */
+template <int W>
+void SafraExplorer<W>::DecodeTree(const uint64_t &id, Worker *worker) {
+
+    Stripe &stripe = stripes_[id & (NUM_TABLE_STRIPES - 1)];
+    int local_id = id >> TABLE_STRIPE_BITS;
+
+    {
+        std::lock_guard<std::mutex> guard(stripe.lock);
+        const uint8_t *key = stripe.table.GetKey(local_id);
+        worker->scratch_key.assign(key,
+            key + stripe.table.GetKeyLength(local_id));
+    }
+
+    worker->scratch_tree->Decode(&worker->scratch_key[0],
+        worker->scratch_key.size());
+}
+
+/*
+ * Deletes worker's scratch & successor trees, which hands their node arrays
+ *   back to its arena
+ */
+template <int W>
+void SafraExplorer<W>::DeleteTrees(Worker *worker) {
+
+    delete worker->scratch_tree;
+    worker->scratch_tree = NULL;
+    for (SafraTree<W> *tree : worker->successor_trees) {
+        delete tree;
+    }
+    worker->successor_trees.clear();
+}
+
+
+// ============================== Renumbering =============================== //
+
+// Marks a tree that no worker has expanded while renumbering
+#define NO_ENTRY UINT64_MAX
+
+template <int W>
+uint64_t SafraExplorer<W>::FlatIndex(const uint64_t &id) {
+    return stripe_offsets_[id & (NUM_TABLE_STRIPES - 1)] +
+        (id >> TABLE_STRIPE_BITS);
+}
+
+/*
+ * Merges the workers' transition buffers and assigns final state numbers in
+ *   BFS order from the initial tree, filling in the Rabin automaton's
+ *   transitions and (from the recorded label masks) pairs.
+ */
+template <int W>
+void SafraExplorer<W>::Renumber(const uint64_t &initial_id) {
+
+    int alphabet_size = automaton_->GetAlphabetSize();
+
+    // Lay the stripes out one after another
+    stripe_offsets_.clear();
+    uint64_t num_states = 0;
+    for (Stripe &stripe : stripes_) {
+        stripe_offsets_.push_back(num_states);
+        num_states += stripe.table.Size();
+    }
+
+    // entries[flat index] is i * num_threads + t if the tree is entry i of
+    //   worker t's buffers, which hold its |Sigma| provisional successors &
+    //   its two label masks
+    std::vector<uint64_t> entries(num_states, NO_ENTRY);
+    for (int t = 0; t < num_threads_; t++) {
+        for (size_t i = 0; i < workers_[t]->sources.size(); i++) {
+            entries[FlatIndex(workers_[t]->sources[i])] = i * num_threads_ + t;
+        }
+    }
+    uint64_t num_labels = 2*automaton_->GetNumStates();
+
+    // BFS over flat indices, numbering trees in the order they are reached
+    std::vector<int> state_of(num_states, -1);
+    std::vector<uint64_t> order;
+    order.reserve(num_states);
+
+    uint64_t initial = FlatIndex(initial_id);
+    state_of[initial] = 0;
+    order.push_back(initial);
+
+    rabin_ = RabinAutomaton(num_states, alphabet_size,
+        2*automaton_->GetNumStates());
+
+    for (size_t state = 0; state < order.size(); state++) {
+        uint64_t entry = entries[order[state]];
+        assert(entry != NO_ENTRY);
+        Worker *worker = workers_[entry % num_threads_];
+        uint64_t i = entry / num_threads_;
+        const uint64_t *row = &worker->successors[i * alphabet_size];
+
+        AddRabinPairs(state, worker->label_bits, i * 2 * num_labels);
+
+        for (int c = 0; c < alphabet_size; c++) {
+            uint64_t post = FlatIndex(row[c]);
+            if (state_of[post] == -1) {
+                state_of[post] = order.size();
+                order.push_back(post);
+            }
+            rabin_.SetSuccessor(state, c, state_of[post]);
+        }
+    }
+
+    ids_ = std::vector<uint64_t>(num_states);
+    for (int s = 0; s < NUM_TABLE_STRIPES; s++) {
+        for (int i = 0; i < stripes_[s].table.Size(); i++) {
+            ids_[state_of[stripe_offsets_[s] + i]] =
+                ((uint64_t) i << TABLE_STRIPE_BITS) | s;
+        }
+    }
+
+    // The per-thread buffers are no longer needed
+    for (Worker *worker : workers_) {
+        std::vector<uint64_t>().swap(worker->sources);
+        std::vector<uint64_t>().swap(worker->successors);
+        std::vector<uint64_t>().swap(worker->label_bits);
+    }
+}
+
+
+/*
+ * Puts state into the left side of the Rabin pair of every label its tree
+ *   does not use (or has renamed), and into the right side for every label on
+ *   a marked node, reading the label masks that start at bits[first_bit]
+ */
+template <int W>
+void SafraExplorer<W>::AddRabinPairs(const int &state,
+    const std::vector<uint64_t> &bits, const uint64_t &first_bit) {
+
+    int num_labels = rabin_.GetNumLabels();
+
+    for (int label = 0; label < num_labels; label++) {
+        uint64_t left = first_bit + label;
+        uint64_t right = left + num_labels;
+
+        if ((bits[left / 64] >> (left % 64)) & 1) {
+            rabin_.AddToLeft(label, state);
+        }
+        if ((bits[right / 64] >> (right % 64)) & 1) {
+            rabin_.AddToRight(label, state);
+        }
+    }
+}
+
+
+// ============================== Checkpoints =============================== //
+
+namespace {
+
+/*
+ * Bounds-checked cursor over a mapped checkpoint file. Once a read runs past
+ *   the end, ok is false & every further read returns 0 / NULL.
+ */
+struct CheckpointReader {
+    const uint8_t *position;
+    const uint8_t *end;
+    bool ok;
+
+    uint64_t Varint() {
+        uint64_t value = 0;
+        for (int shift = 0; ok && shift < 64 && position < end; shift += 7) {
+            uint8_t byte = *position++;
+            value |= (uint64_t) (byte & 0x7f) << shift;
+            if (byte < 0x80) {
+                return value;
+            }
+        }
+        ok = false;
+        return 0;
+    }
+
+    const uint8_t *Bytes(const uint64_t &length) {
+        if (!ok || length > (uint64_t) (end - position)) {
+            ok = false;
+            return NULL;
+        }
+        const uint8_t *bytes = position;
+        position += length;
+        return bytes;
+    }
+};
+
+}
+
+template <int W>
+void SafraExplorer<W>::SetCheckpoint(const char *file_name,
+    const double &interval_seconds) {
+    checkpoint_file_name_ = file_name;
+    checkpoint_interval_ = interval_seconds;
+}
+
+template <int W>
+const std::string &SafraExplorer<W>::GetCheckpointError() {
+    return checkpoint_error_;
+}
+
+/*
+ * Run by worker 0 between two trees: waits until every other worker is
+ *   paused (or done) so the queues, buffers & tables hold still, writes the
+ *   checkpoint & lets the workers go on
+ */
+template <int W>
+void SafraExplorer<W>::Checkpoint() {
+
+    std::unique_lock<std::mutex> lock(pause_lock_);
+    pause_ = true;
+
+    // With nothing pending the run is about to end, & no worker may pause
+    if (pending_.load() > 0) {
+        pause_changed_.wait(lock, [this]() {
+            return num_paused_ + num_finished_ == num_threads_ - 1;
+        });
+
+        if (!WriteCheckpoint(checkpoint_error_)) {
+            checkpoint_file_name_.clear();
+        }
+    }
+
+    pause_ = false;
+    pause_changed_.notify_all();
+
+    next_checkpoint_ = std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(checkpoint_interval_));
+}
+
+template <int W>
+void SafraExplorer<W>::WaitForCheckpoint() {
+
+    std::unique_lock<std::mutex> lock(pause_lock_);
+    num_paused_++;
+    pause_changed_.notify_all();
+    pause_changed_.wait(lock, [this]() { return !pause_.load(); });
+    num_paused_--;
+}
+
+/*
+ * Layout (varints unless noted): CHECKPOINT_MAGIC (8 bytes), version, W, n,
+ *   |Sigma|, canonical labels, NUM_TABLE_STRIPES, the automaton's fingerprint
+ *   (8 bytes), the initial tree's provisional id, the counters (trees
+ *   generated, dedup hits, max tree nodes, max tree depth, never used labels
+ *   as 2W raw words), every stripe's keys in id order (count, then length &
+ *   bytes of each), the queued ids (count, then ids), the expanded trees
+ *   (count, then each id followed by its |Sigma| successor ids), and
+ *   CHECKPOINT_END_MAGIC (8 bytes).
+ */
+template <int W>
+bool SafraExplorer<W>::WriteCheckpoint(std::string &error) {
+
+    std::string temporary_file_name = checkpoint_file_name_ + ".tmp";
+
+    OutputBuffer out;
+    if (!out.Open(temporary_file_name.c_str())) {
+        error = "cannot create " + temporary_file_name;
+        return false;
+    }
+
+    uint64_t fingerprint = Fingerprint();
+
+    out.Write(CHECKPOINT_MAGIC, 8);
+    out.WriteVarint(CHECKPOINT_VERSION);
+    out.WriteVarint(W);
+    out.WriteVarint(automaton_->GetNumStates());
+    out.WriteVarint(automaton_->GetAlphabetSize());
+    out.WriteVarint(canonical_labels_);
+    out.WriteVarint(NUM_TABLE_STRIPES);
+    out.Write((const char *) &fingerprint, sizeof(fingerprint));
+    out.WriteVarint(initial_id_);
+
+    ExplorerStats stats = GetStats();
+    Labels never_used_labels = workers_[0]->never_used_labels;
+    for (Worker *worker : workers_) {
+        never_used_labels = Labels::Intersect(never_used_labels,
+            worker->never_used_labels);
+    }
+
+    out.WriteVarint(stats.trees_generated);
+    out.WriteVarint(stats.dedup_hits);
+    out.WriteVarint(stats.max_tree_nodes);
+    out.WriteVarint(stats.max_tree_depth);
+    out.Write((const char *) never_used_labels.GetWords(),
+        2 * W * sizeof(uint64_t));
+
+    for (Stripe &stripe : stripes_) {
+        out.WriteVarint(stripe.table.Size());
+        for (int i = 0; i < stripe.table.Size(); i++) {
+            out.WriteVarint(stripe.table.GetKeyLength(i));
+            out.Write((const char *) stripe.table.GetKey(i),
+                stripe.table.GetKeyLength(i));
+        }
+    }
+
+    uint64_t num_queued = 0, num_expanded = 0;
+    for (Worker *worker : workers_) {
+        num_queued += worker->deque.size();
+        num_expanded += worker->sources.size();
+    }
+
+    out.WriteVarint(num_queued);
+    for (Worker *worker : workers_) {
+        for (uint64_t id : worker->deque) {
+            out.WriteVarint(id);
+        }
+    }
+
+    int alphabet_size = automaton_->GetAlphabetSize();
+    out.WriteVarint(num_expanded);
+    for (Worker *worker : workers_) {
+        for (size_t i = 0; i < worker->sources.size(); i++) {
+            out.WriteVarint(worker->sources[i]);
+            for (int c = 0; c < alphabet_size; c++) {
+                out.WriteVarint(worker->successors[i * alphabet_size + c]);
+            }
+        }
+    }
+
+    out.Write(CHECKPOINT_END_MAGIC, 8);
+
+    if (!out.Close()) {
+        remove(temporary_file_name.c_str());
+        error = "cannot write " + temporary_file_name;
+        return false;
+    }
+
+    // Only now replace the previous checkpoint, so one is always complete
+    if (rename(temporary_file_name.c_str(), checkpoint_file_name_.c_str()) != 0) {
+        remove(temporary_file_name.c_str());
+        error = "cannot replace " + checkpoint_file_name_;
+        return false;
+    }
+    return true;
+}
+
+template <int W>
+bool SafraExplorer<W>::LoadCheckpoint(const char *file_name,
+    std::string &error) {
+
+    MappedFile file;
+    if (!file.Open(file_name)) {
+        error = std::string("cannot read ") + file_name;
+        return false;
+    }
+
+    const uint8_t *data = (const uint8_t *) file.GetData();
+    CheckpointReader in = { data, data + file.GetSize(), true };
+
+    const uint8_t *magic = in.Bytes(8);
+    if (magic == NULL || memcmp(magic, CHECKPOINT_MAGIC, 8) != 0 ||
+        in.Varint() != CHECKPOINT_VERSION) {
+        error = std::string(file_name) + " is not a checkpoint of this version";
+        return false;
+    }
+
+    uint64_t fingerprint;
+    uint64_t expected[] = { (uint64_t) W, (uint64_t) automaton_->GetNumStates(),
+        (uint64_t) automaton_->GetAlphabetSize(), (uint64_t) canonical_labels_,
+        NUM_TABLE_STRIPES };
+    bool same = true;
+    for (uint64_t value : expected) {
+        same &= (in.Varint() == value);
+    }
+    const uint8_t *fingerprint_bytes = in.Bytes(sizeof(fingerprint));
+    if (fingerprint_bytes != NULL) {
+        memcpy(&fingerprint, fingerprint_bytes, sizeof(fingerprint));
+        same &= (fingerprint == Fingerprint());
+    }
+    if (!in.ok || !same) {
+        error = std::string(file_name) + " was written for another automaton "
+            "or without the same --canonical setting";
+        return false;
+    }
+
+    // Everything below goes into the (freshly reset) explorer as it is read
+    Worker *worker = workers_[0];
+    bool valid = true;
+    bool inserted;
+
+    auto is_tree = [this](const uint64_t &id) {
+        return (id >> TABLE_STRIPE_BITS) <
+            (uint64_t) stripes_[id & (NUM_TABLE_STRIPES - 1)].table.Size();
+    };
+
+    initial_id_ = in.Varint();
+    worker->trees_generated = in.Varint();
+    worker->dedup_hits = in.Varint();
+    worker->max_tree_nodes = (int) in.Varint();
+    worker->max_tree_depth = (int) in.Varint();
+
+    uint64_t never_used_words[2 * W];
+    const uint8_t *never_used_bytes = in.Bytes(sizeof(never_used_words));
+    if (never_used_bytes != NULL) {
+        memcpy(never_used_words, never_used_bytes, sizeof(never_used_words));
+        worker->never_used_labels = Labels::FromWords(never_used_words);
+    }
+
+    for (int s = 0; s < NUM_TABLE_STRIPES && in.ok && valid; s++) {
+        uint64_t count = in.Varint();
+
+        for (uint64_t i = 0; i < count && in.ok && valid; i++) {
+            uint64_t length = in.Varint();
+            const uint8_t *key = in.Bytes(length);
+
+            // The key's hash is the fold of its values (see SafraTree::Encode)
+            CheckpointReader values = { key, key + length, key != NULL };
+            uint64_t hash = HASH_SEED;
+            while (values.ok && values.position < values.end) {
+                hash = HashWord(hash, values.Varint());
+            }
+
+            valid = values.ok &&
+                (int) (hash >> (64 - TABLE_STRIPE_BITS)) == s &&
+                stripes_[s].table.Insert(key, length, hash, inserted) == (int) i;
+        }
+    }
+
+    valid = valid && is_tree(initial_id_);
+
+    uint64_t num_queued = in.Varint();
+    for (uint64_t i = 0; i < num_queued && in.ok && valid; i++) {
+        uint64_t id = in.Varint();
+        valid = is_tree(id);
+        PushWork(i % num_threads_, id);
+    }
+
+    int alphabet_size = automaton_->GetAlphabetSize();
+    uint64_t num_expanded = in.Varint();
+    for (uint64_t i = 0; i < num_expanded && in.ok && valid; i++) {
+        worker->sources.push_back(in.Varint());
+        valid = is_tree(worker->sources.back());
+        for (int c = 0; c < alphabet_size; c++) {
+            worker->successors.push_back(in.Varint());
+            valid &= is_tree(worker->successors.back());
+        }
+
+        // The label masks are not saved, but follow from the tree
+        if (valid) {
+            DecodeTree(worker->sources.back(), worker);
+            AddLabelMasks(worker, worker->scratch_tree);
+        }
+    }
+
+    const uint8_t *end_magic = in.Bytes(8);
+    if (!in.ok || !valid || memcmp(end_magic, CHECKPOINT_END_MAGIC, 8) != 0) {
+        Reset(automaton_);
+        error = std::string(file_name) + " is truncated or corrupt";
+        return false;
+    }
+
+    resumed_ = true;
+    return true;
+}
+
+/*
+ * Hash of the automaton's size, transitions, initial & final states, which a
+ *   checkpoint must match to be resumed
+ */
+template <int W>
+uint64_t SafraExplorer<W>::Fingerprint() {
+
+    uint64_t hash = HASH_SEED;
+    hash = HashWord(hash, automaton_->GetNumStates());
+    hash = HashWord(hash, automaton_->GetAlphabetSize());
+
+    for (int state = 0; state < automaton_->GetNumStates(); state++) {
+        for (int c = 0; c < automaton_->GetAlphabetSize(); c++) {
+            StateSet<W> post = automaton_->GetTransition<W>(state, c);
+            for (int w = 0; w < W; w++) {
+                hash = HashWord(hash, post.GetWord(w));
+            }
+        }
+    }
+
+    StateSet<W> initial_states = automaton_->GetInitialStates<W>();
+    StateSet<W> final_states = automaton_->GetFinalStates<W>();
+    for (int w = 0; w < W; w++) {
+        hash = HashWord(hash, initial_states.GetWord(w));
+        hash = HashWord(hash, final_states.GetWord(w));
+    }
+    return hash;
+}
+
+
+// Explicit instantiations for every supported state set width
+#define INSTANTIATE_SAFRA_EXPLORER(W) template class SafraExplorer<W>;
+SAFRA_FOR_EACH_WIDTH(INSTANTIATE_SAFRA_EXPLORER)
+#undef INSTANTIATE_SAFRA_EXPLORER
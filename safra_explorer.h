@@ -0,0 +1,232 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *    safra_explorer.h - (parallel) exploration of the reachable Safra trees  *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+
+#include "buechi_automaton.h"
+#include "safra_tree.h"
+#include "tree_table.h"
+#include "rabin_automaton.h"
+#include "output_buffer.h"
+
+// The dedup table is split into 2^TABLE_STRIPE_BITS independently locked stripes
+#define TABLE_STRIPE_BITS 6
+#define NUM_TABLE_STRIPES (1 << TABLE_STRIPE_BITS)
+
+// First & last 8 bytes of a checkpoint file, & the version of its layout
+#define CHECKPOINT_MAGIC "SAFRACKP"
+#define CHECKPOINT_END_MAGIC "SAFRAEND"
+#define CHECKPOINT_VERSION 1
+
+/*
+ * Counters & timings of one exploration, reported by --stats
+ */
+struct ExplorerStats {
+    double explore_ms;          // expanding trees (all workers)
+    double renumber_ms;         // numbering states, transitions & Rabin pairs
+
+    uint64_t trees_generated;   // every tree built, the initial one included
+    uint64_t dedup_hits;        // trees that were already in the table
+    uint64_t dedup_misses;      // trees that were new
+
+    int max_tree_nodes;
+    int max_tree_depth;
+    int labels_used;            // labels on a node of at least one tree
+    int labels_available;       // 2n
+
+    uint64_t table_entries;     // over all stripes of the dedup table
+    uint64_t table_slots;
+    uint64_t table_lookups;
+    uint64_t table_probes;
+    int table_max_probe;
+};
+
+
+/*
+ * Computes every Safra tree reachable from the initial tree, and the
+ *   transitions between them, using num_threads worker threads.
+ *
+ * Each worker owns a deque of unexplored trees: it pushes and pops at the back
+ *   of its own deque and, when that runs dry, steals from the front of another
+ *   worker's. New trees are deduplicated in a striped hash table (one lock per
+ *   stripe, chosen by the tree's hash), which hands out provisional ids, and
+ *   each worker records the transitions it computes in its own buffer.
+ *
+ * No tree is kept as nodes once it has been looked up: the table's key pool,
+ *   which holds the compact encoding of every tree found (see
+ *   SafraTree::Encode), is the only copy, and the deques only hold ids. A
+ *   worker decodes a tree into its scratch tree when it takes it up for
+ *   expansion, and the results decode trees the same way when asked for them.
+ *
+ * Once every tree is explored, the provisional ids are replaced by the order
+ *   in which a breadth-first search from the initial tree (letters in
+ *   increasing order) first reaches each tree. That is exactly the numbering a
+ *   sequential BFS would assign, so the result does not depend on the number
+ *   of threads or on how the work was scheduled. The Rabin pairs are filled
+ *   in during that search from label masks recorded when each tree was
+ *   expanded, so the trees are not decoded again.
+ */
+template <int W>
+class SafraExplorer {
+public:
+
+    // With canonical_labels, trees that differ only in label names are one
+    //   state if the same nodes were just renamed (see
+    //   SafraTree::CanonicalizeLabels). Every worker's node arena takes its
+    //   memory from allocator.
+    SafraExplorer(const BuchiAutomaton *automaton, int num_threads,
+        bool canonical_labels, const SafraAllocator &allocator);
+    ~SafraExplorer();
+
+    // The table stripes are cache-line aligned, which plain operator new does
+    //   not honour before C++17, so explorers on the heap get aligned memory
+    static void *operator new(size_t size);
+    static void operator delete(void *memory);
+
+    // Explores the whole reachable state space
+    void Run();
+
+    // Drops the results of the last Run & readies the explorer for a Run over
+    //   automaton (which needs the same state set width). Node arenas & table
+    //   memory are kept, so many small runs do not go back to the allocator.
+    void Reset(const BuchiAutomaton *automaton);
+
+    // Makes Run write a checkpoint to file_name every interval_seconds: the
+    //   workers pause after their current tree, and the dedup table, the
+    //   queued trees, the transitions found so far & the counters are written
+    //   to a temporary file that then replaces file_name. If a checkpoint
+    //   cannot be written, Run goes on without checkpoints.
+    void SetCheckpoint(const char *file_name, const double &interval_seconds);
+
+    // Restores the state saved in a checkpoint, so that the next Run carries
+    //   on from there, with any number of threads, & gives the same result as
+    //   an uninterrupted run. Call right after construction or Reset. Returns
+    //   false, with a description in error, if the file cannot be read or was
+    //   written for another automaton or label mode.
+    bool LoadCheckpoint(const char *file_name, std::string &error);
+
+    // Why the last checkpoint failed, or "" if none has
+    const std::string &GetCheckpointError();
+
+    // Counters of the last Run
+    ExplorerStats GetStats();
+
+    // Results, in final (BFS) numbering. State 0 is the initial tree. The
+    //   tree of a state is decoded on each call (not thread-safe).
+    int GetNumStates();
+    const RabinAutomaton &GetRabinAutomaton();
+    std::string TreeToString(const int &state);
+    void WriteTree(const int &state, OutputBuffer &out);
+
+private:
+
+    typedef typename SafraTree<W>::Labels Labels;
+
+    // Per-thread state: a work-stealing deque of provisional ids, a node
+    //   arena with a scratch tree to decode work into & |Sigma| trees for its
+    //   successors, the transitions found
+    //   by this thread (successors holds |Sigma| provisional ids per entry of
+    //   sources, and label_bits 2 * 2n bits per entry: its tree's unused or
+    //   renamed labels followed by its marked labels), & its share of the
+    //   statistics
+    struct Worker {
+        std::mutex lock;
+        std::deque<uint64_t> deque;
+        SafraArena<W> *arena;
+        SafraTree<W> *scratch_tree;
+        std::vector<SafraTree<W> *> successor_trees;
+        std::vector<uint8_t> scratch_key;
+        std::vector<uint64_t> sources;
+        std::vector<uint64_t> successors;
+        std::vector<uint64_t> label_bits;
+
+        uint64_t trees_generated;
+        uint64_t dedup_hits;
+        int max_tree_nodes;
+        int max_tree_depth;
+        Labels never_used_labels;
+    };
+
+    // One stripe of the dedup table, padded so stripes never share a cache line
+    struct alignas(64) Stripe {
+        std::mutex lock;
+        TreeTable table;
+    };
+
+    void WorkerLoop(const int &t);
+    bool PopWork(const int &t, uint64_t &id);
+    void PushWork(const int &t, const uint64_t &id);
+    uint64_t InsertTree(SafraTree<W> *tree, std::vector<uint8_t> &key,
+        bool &inserted);
+    void DecodeTree(const uint64_t &id, Worker *worker);
+    void DeleteTrees(Worker *worker);
+    void Renumber(const uint64_t &initial_id);
+    void CountNewTree(Worker *worker, SafraTree<W> *tree);
+    void AddLabelMasks(Worker *worker, SafraTree<W> *tree);
+    void AddRabinPairs(const int &state, const std::vector<uint64_t> &bits,
+        const uint64_t &first_bit);
+
+    // Checkpoints: worker 0 pauses the other workers (which wait in
+    //   WaitForCheckpoint, unless they have finished) & writes the file
+    void Checkpoint();
+    void WaitForCheckpoint();
+    bool WriteCheckpoint(std::string &error);
+    uint64_t Fingerprint();
+
+    // Position of a provisional id among all stripes (0..N-1, unordered)
+    uint64_t FlatIndex(const uint64_t &id);
+
+    const BuchiAutomaton *automaton_;
+    int num_threads_;
+    bool canonical_labels_;
+
+    std::vector<Worker *> workers_;
+    Stripe stripes_[NUM_TABLE_STRIPES];
+    std::vector<uint64_t> stripe_offsets_;
+
+    // Number of trees that have been queued but not fully expanded yet
+    std::atomic<long long> pending_;
+
+    // Checkpoint file & period (checkpoints are off if the name is empty),
+    //   and the pause every worker but worker 0 waits in while one is written
+    std::string checkpoint_file_name_;
+    double checkpoint_interval_;
+    std::chrono::steady_clock::time_point next_checkpoint_;
+    std::string checkpoint_error_;
+
+    std::atomic<bool> pause_;
+    std::mutex pause_lock_;
+    std::condition_variable pause_changed_;
+    int num_paused_;
+    int num_finished_;
+
+    // Set by LoadCheckpoint: Run then continues from the restored state
+    //   instead of starting from the initial tree
+    bool resumed_;
+    uint64_t initial_id_;
+
+    double explore_ms_;
+    double renumber_ms_;
+
+    // Final results: the transitions between trees & the Rabin pairs, and
+    //   the provisional id of every state's tree
+    RabinAutomaton rabin_;
+    std::vector<uint64_t> ids_;
+};
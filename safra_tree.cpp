@@ -12,132 +12,214 @@
 #include <unordered_map>
 #include <set>
 #include <unordered_set>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <cstdint>
-#include <queue>
+#include <new>
 
 #include "safra_tree.h"
 
-// Constants
-int BITS_PER_ITEM = 64;
-int64_t EMPTY_SET = 0;
+// Bytes of nodes in each arena chunk. A chunk holds as many node arrays as fit
+//   (at least one), so wide automata do not pay for hundreds of spare trees.
+#define ARENA_CHUNK_BYTES (64 * 1024)
 
 // ========== Standard constructor, copy constructor, & destructor ========== //
 
 /*
- * TODO: Change arguments so that constructor takes automaton as input
  * Standard constructor: creates a Safra tree based on the initial state set of
  *   the Buchi automaton
  */
-SafraTree::SafraTree(int num_states, int alphabet_size,
-    std::vector<int64_t> transition, int64_t initial_states,
-    int64_t final_states) {
-
-    num_states_ = num_states;
-    transition_rule_ = std::vector<int64_t>(transition);
-    initial_states_ = initial_states;
-    final_states_ = final_states;
-
-    unused_labels_ = new std::priority_queue<int, std::vector<int>, std::greater<int>>();
-
-    //initialize priority queue that contains every number from 1 to 2*n
-    for (int i = 0; i < 2*num_states_; i++) {
-        unused_labels_->push(i);
+template <int W>
+SafraTree<W>::SafraTree(SafraArena<W> *arena, const BuchiAutomaton *automaton,
+    const bool &canonical_labels) {
+
+    automaton_ = automaton;
+    canonical_labels_ = canonical_labels;
+    int num_states = automaton_->GetNumStates();
+    States initial_states = GetInitialStates();
+    States final_states = GetFinalStates();
+
+    arena_ = arena;
+    nodes_ = arena_->Allocate();
+    num_nodes_ = 0;
+
+    //initialize label pool that contains every number from 1 to 2*n
+    for (int i = 0; i < 2*num_states; i++) {
+        unused_labels_.Insert(i);
     }
 
     // Create initial node setup
-    if (Intersect(initial_states_, final_states_) == EMPTY_SET) { 
+    if (Intersect(initial_states, final_states).IsEmpty()) {
         // Empty intersection between I and F
         // => Initial tree is (1 : I)
-        root_ = new SafraNode(initial_states_, false, this);
+        AddNode(initial_states, false, NO_NODE);
     }
-    else if (Difference(initial_states_, final_states_) == EMPTY_SET) {
+    else if (Difference(initial_states, final_states).IsEmpty()) {
         // I is a subset of F
         // => Initial tree is (1 : I!)
-        root_ = new SafraNode(initial_states_, true, this);
+        AddNode(initial_states, true, NO_NODE);
     }
     else {
         // Otherwise
         // => Initial tree is (1 : I, 2 : I n F!)
-        root_ = new SafraNode(initial_states_, false, this);
-        SafraNode *child = new SafraNode(
-            Intersect(initial_states_, final_states), true, this);
-
-        root_->AppendChild(child);
+        int root = AddNode(initial_states, false, NO_NODE);
+        AddNode(Intersect(initial_states, final_states), true, root);
     }
 
 }
 
-void SafraTree::CopyChildren(SafraNode *node, SafraNode *other_node,
-    std::unordered_set<int> &used_labels) {
 
-    for (SafraNode *other_child : other_node->GetChildren()) {
-        // Add label into our used set, append an identical child to our node
-        used_labels.insert(other_child->GetLabel());
-        SafraNode *child = new SafraNode(other_child, this);
+/*
+ * Transition constructor: Given an original SafraTree and a character, produces
+ *   a new SafraTree that corresponds to the transition from the given tree
+ *   along the specified character. The new tree's nodes come from arena, which
+ *   need not be the arena of the original (each thread has its own).
+ */
+template <int W>
+SafraTree<W>::SafraTree(SafraArena<W> *arena, SafraTree *original,
+    const int &character)
+    : SafraTree(arena, original) {
+
+    // Run all 6 steps on the copied tree
+    UnmarkAndUpdateAll(character);
+    FinishTransition();
+}
 
-        node->AppendChild(child);
 
-        // Recursively copy all of the child's children
-        CopyChildren(child, other_child, used_labels);
-    }
+/*
+ * Copies original's nodes and label pool over in one block each. The tree is
+ *   left exactly as it was before step (1).
+ */
+template <int W>
+SafraTree<W>::SafraTree(SafraArena<W> *arena, SafraTree *original) {
+
+    arena_ = arena;
+    nodes_ = arena_->Allocate();
+    CopyFrom(original);
 }
 
 
 /*
- * Transition constructor: Given an original SafraTree and a character, produces
- *   a new SafraTree that corresponds to the transition from the given tree
- *   along the specified character
+ * Replaces this tree with original, keeping this tree's node array
  */
-SafraTree::SafraTree(SafraTree *original, const int &character) {
+template <int W>
+void SafraTree<W>::CopyFrom(SafraTree *original) {
+
+    // Share the automaton, copy nodes over in one block
+    automaton_ = original->automaton_;
+
+    num_nodes_ = original->num_nodes_;
+    memcpy(nodes_, original->nodes_, num_nodes_ * sizeof(Node));
+
+    unused_labels_ = original->unused_labels_;
+    canonical_labels_ = original->canonical_labels_;
+    renamed_labels_ = Labels();
+}
 
-    // Part 1: Copy tree structure over
 
-    std::unordered_set<int> used_labels;
+/*
+ * Batched transition: produces the successors along every character in one
+ *   traversal, in the trees the caller keeps for them. Steps (1) & (2) compute
+ *   each node's images along all characters together. Only steps (3) - (6)
+ *   are run per successor.
+ */
+template <int W>
+void SafraTree<W>::GetSuccessors(const std::vector<SafraTree *> &successors) {
 
-    // Copy over data about automaton
-    initial_states_ = original->initial_states_;
-    final_states_ = original->final_states_;
-    num_states_ = original->num_states_;
-    transition_rule_ = std::vector<int64_t>(original->transition_rule_);
+    int alphabet_size = automaton_->GetAlphabetSize();
+    assert((int) successors.size() == alphabet_size);
+
+    for (int c = 0; c < alphabet_size; c++) {
+        successors[c]->CopyFrom(this);
+    }
 
-    // Copy nodes over, keeping track of which labels have been used
-    root_ = new SafraNode(original->root_, this);
-    used_labels.insert(root_->GetLabel());
-    CopyChildren(root_, original->GetRoot(), used_labels);
+    // Steps (1) & (2) for every character in one pass over the nodes
+    States *images = arena_->GetScratchImages(alphabet_size);
 
-    // Build unused_labels_ priority queue (only contains things not in our
-    //   used_labels set)
-    unused_labels_ = new
-        std::priority_queue<int, std::vector<int>,std::greater<int>>();
+    for (int node = 0; node < num_nodes_; node++) {
+        automaton_->GetImages(nodes_[node].states, images);
 
-    for (int i = 0; i < 2*num_states_; i++) {
-        if (used_labels.find(i) == used_labels.end()) {
-            unused_labels_->push(i);
+        for (int c = 0; c < alphabet_size; c++) {
+            successors[c]->nodes_[node].marked = false;
+            successors[c]->nodes_[node].states = images[c];
         }
     }
 
-    // Part 2: Run all 6 steps on the new tree
-    UnmarkAndUpdateAll(character);
+    for (SafraTree *successor : successors) {
+        successor->FinishTransition();
+    }
+}
+
+
+/*
+ * Runs steps (3) - (6) and restores preorder
+ */
+template <int W>
+void SafraTree<W>::FinishTransition() {
     AttachChildren();
-    HorizontalMerge();
-    KillEmptyNodes();
-    VerticalMerge();
+    MergeAndPrune();
+    Compact();
+
+    if (canonical_labels_) {
+        CanonicalizeLabels();
+    }
 }
 
+
 /*
- * Destructor: Frees up all resources used by this Safra tree
+ * Renames every label to its rank among the labels in use, so the labels of a
+ *   tree with k nodes are exactly 0 .. k-1. Labels are only ever handed out
+ *   above the ones in use, so the rank of a label is its node's age rank, and
+ *   trees that differ only in label names become the same tree, unless their
+ *   labels were renamed at different nodes: the renamed labels are part of
+ *   the encoding (see Encode), so such trees stay apart.
+ *
+ * A node's label changes only when an older node was removed. Those labels
+ *   are recorded as renamed and count as unused for the Rabin pairs: a pair
+ *   can then only accept through a single node that eventually keeps its
+ *   label forever, as in the unrenamed construction. Such a node has finitely
+ *   many older nodes, so it is renamed only finitely often.
  */
-SafraTree::~SafraTree() {
+template <int W>
+void SafraTree<W>::CanonicalizeLabels() {
+
+    int *new_label = arena_->GetScratchIndices();
+    int num_labels = 2 * automaton_->GetNumStates();
 
-    // free root and all its children
-    delete root_;
+    int rank = 0;
+    for (int label = 0; label < num_labels; label++) {
+        if (!unused_labels_.Contains(label)) {
+            new_label[label] = rank++;
+        }
+    }
+
+    renamed_labels_ = Labels();
+    for (int node = 0; node < num_nodes_; node++) {
+        int label = nodes_[node].label;
+        if (new_label[label] != label) {
+            nodes_[node].label = new_label[label];
+            renamed_labels_.Insert(new_label[label]);
+        }
+    }
 
-    // free priority queue
-    delete unused_labels_;
+    unused_labels_ = Labels();
+    for (int label = rank; label < num_labels; label++) {
+        unused_labels_.Insert(label);
+    }
+}
+
+/*
+ * Destructor: Frees up all resources used by this Safra tree
+ */
+template <int W>
+SafraTree<W>::~SafraTree() {
+
+    // hand node array back to the arena
+    arena_->Release(nodes_);
 }
 
 
@@ -152,403 +234,726 @@ SafraTree::~SafraTree() {
  * Step 2: Update all state sets in the tree according to the Buechi automaton's
  *   transition system
  */
+template <int W>
+void SafraTree<W>::UnmarkAndUpdateAll(const int &c) {
 
-void SafraTree::SafraNode::UnmarkAndUpdate(const int &c) {
-
-    SetMarked(false);
-    int64_t new_states = 0;
-    for (int i = 0; i < tree_->num_states_; i++) {
-        if (((states_ >> i) & 1) == 1) {
-            new_states = tree_->Union(new_states, tree_->Transition(i, c));
-        }
-    }
-    SetStates(new_states);
-
-    for (SafraNode *child : children_) {
-        child->UnmarkAndUpdate(c);
+    for (int node = 0; node < num_nodes_; node++) {
+        nodes_[node].marked = false;
+        nodes_[node].states = automaton_->GetImage(nodes_[node].states, c);
     }
 }
 
-void SafraTree::UnmarkAndUpdateAll(const int &c) {
-    GetRoot()->UnmarkAndUpdate(c);
-}
-
 
 /*
  * STEP 3: For every node v, if v's label set shares at least one state with
  *   the final states, create a new rightmost child u to v. Set the label set
  *   of u to the intersection between v's label set and the final states, and
  *   mark u.
+ *
+ * Nodes are visited in postorder, so new nodes receive their labels in the
+ *   same order as in the recursive formulation and are never visited
+ *   themselves.
  */
+template <int W>
+void SafraTree<W>::AttachChildren() {
 
-void SafraTree::SafraNode::CreateChild() {
+    States final_states = GetFinalStates();
 
-    int64_t parent_states = GetStates();
-    int64_t child_states = Intersect(parent_states, GetTree()->final_states_);
+    int node = 0;
+    while (nodes_[node].first_child != NO_NODE) {
+        node = nodes_[node].first_child;
+    }
 
-    if (child_states != EMPTY_SET) {
+    while (node != NO_NODE) {
+
+        // Find the next node in postorder before adding any new children
+        int next = NO_NODE;
+        if (node != 0) {
+            next = nodes_[node].next_sibling;
+            if (next == NO_NODE) {
+                next = nodes_[node].parent;
+            }
+            else {
+                while (nodes_[next].first_child != NO_NODE) {
+                    next = nodes_[next].first_child;
+                }
+            }
+        }
 
-        bool child_is_marked = true;
-        SafraNode *child = new SafraNode(child_states, child_is_marked,
-            GetTree());
-        AppendChild(child);
-    }
-}
+        States child_states = Intersect(nodes_[node].states, final_states);
+        if (!child_states.IsEmpty()) {
+            bool child_is_marked = true;
+            AddNode(child_states, child_is_marked, node);
+        }
 
-void SafraTree::SafraNode::AttachChildrenToAllNodes() {
-    for (SafraNode *child : GetChildren()) {
-        child->AttachChildrenToAllNodes();
+        node = next;
     }
-    CreateChild();
 }
 
 
-void SafraTree::AttachChildren() {
-    GetRoot()->AttachChildrenToAllNodes();
-}
-
 /*
- * STEP 4: For all new nodes u, remove all states in u's label set (as well as
- *   the state sets of u's children) that already appear in u's older siblings.
+ * STEPS 4 - 6 in one preorder pass:
+ *   (4) for every node u, remove from u's state set (and from the state sets
+ *       of u's descendants) every state that appears in u's older siblings
+ *   (5) remove every node whose state set is empty
+ *   (6) mark every node v whose state set is the union of its children's
+ *       state sets, and remove those children
+ *
+ * Instead of rewriting whole subtrees, every node v carries removed[v], the
+ *   states that step (4) strips from v's subtree: removed[v] is removed[p]
+ *   plus everything in v's older siblings, where p is v's parent. When a node
+ *   is visited its own states are final, so its children can be finished,
+ *   the empty ones cut off (5), and the node checked against the union of
+ *   the survivors (6) before the walk moves on.
  */
-void SafraTree::SafraNode::RecursiveRemoveFromStates(int64_t r_states) {
+template <int W>
+void SafraTree<W>::MergeAndPrune() {
 
-    SetStates(Difference(GetStates(), r_states));
+    States *removed = arena_->GetScratchStates();
+    removed[0] = States();
 
-    for (SafraNode *child : GetChildren()) {
-        child->RecursiveRemoveFromStates(r_states);
-    }
-}
+    int node = 0;
 
-void SafraTree::SafraNode::HorizontalMergeNodeLevel() {
+    while (node != NO_NODE) {
 
-    int64_t seen_states = EMPTY_SET;
+        States seen_states = removed[node];
+        States all_children_states;
 
-    for (SafraNode *child : GetChildren()) {
-        int64_t child_states = child->GetStates();
-        child->RecursiveRemoveFromStates(seen_states);
-        seen_states = Union(seen_states, child_states);
-    }
-}
+        int *link = &nodes_[node].first_child;
 
+        while (*link != NO_NODE) {
+            int child = *link;
 
+            // (4) Remove states that appear in older siblings
+            States child_states = nodes_[child].states;
+            nodes_[child].states = Difference(child_states, seen_states);
+            removed[child] = seen_states;
+            seen_states = Union(seen_states, child_states);
 
-void SafraTree::SafraNode::HorizontalMergeAllNodes() {
+            // (5) Remove the child if that left it empty
+            if (nodes_[child].states.IsEmpty()) {
+                *link = nodes_[child].next_sibling;
+                ReleaseSubtree(child);
+            } else {
+                all_children_states = Union(all_children_states,
+                    nodes_[child].states);
+                link = &nodes_[child].next_sibling;
+            }
+        }
 
-    for (SafraNode *child : GetChildren()) {
-        child->HorizontalMergeAllNodes();
-    }
+        // (6) Mark parent, kill children if they cover all of its states
+        if (!nodes_[node].states.IsEmpty() &&
+            nodes_[node].states == all_children_states) {
+
+            nodes_[node].marked = true;
 
-    HorizontalMergeNodeLevel();
+            for (int child = nodes_[node].first_child; child != NO_NODE;
+                child = nodes_[child].next_sibling) {
+                ReleaseSubtree(child);
+            }
+            nodes_[node].first_child = NO_NODE;
+
+            node = SkipSubtree(node, 0);
+        }
+        else {
+            node = NextPreorder(node, 0);
+        }
+    }
 }
 
 
-void SafraTree::HorizontalMerge() {
-    GetRoot()->HorizontalMergeAllNodes();
+template <int W>
+int SafraTree<W>::GetNumNodes() {
+    return num_nodes_;
 }
 
 /*
- * STEP 5: Remove all nodes with empty label sets.
+ * Nodes are in preorder, so every parent's depth is known before its children
  */
-void SafraTree::SafraNode::KillEmptyNodesNodeLevel() {
+template <int W>
+int SafraTree<W>::GetDepth() {
 
-    int i = 0;
+    int *depth = arena_->GetScratchIndices();
+    int max_depth = 0;
 
-    while (i < GetChildren().size()) {
-        SafraNode *child = GetChildren()[i];
-
-        if (child->GetStates() == EMPTY_SET) {
-            EraseChild(i);
-        } else {
-            child->KillEmptyNodesNodeLevel();
-            i++;
+    for (int node = 0; node < num_nodes_; node++) {
+        int parent = nodes_[node].parent;
+        depth[node] = (parent == NO_NODE ? 1 : depth[parent] + 1);
+        if (depth[node] > max_depth) {
+            max_depth = depth[node];
         }
     }
-}
-
-
-void SafraTree::KillEmptyNodes() {
-    GetRoot()->KillEmptyNodesNodeLevel();
+    return max_depth;
 }
 
 
 /*
- * STEP 6: Mark all states v such that v's label set is the union of all of its
- *   children's label sets
+ * These are used to calculate the final accepting Rabin pairs: a label is in
+ *   the tree iff it is not in GetUnusedLabels(), and the labels of marked
+ *   nodes are returned by GetMarkedLabels(). Labels appear at most once in a
+ *   tree.
  */
-void SafraTree::SafraNode::VerticalMergeNodeLevel() {
+template <int W>
+const typename SafraTree<W>::Labels &SafraTree<W>::GetUnusedLabels() {
+    return unused_labels_;
+}
 
-    int64_t all_children_states = EMPTY_SET;
+template <int W>
+typename SafraTree<W>::Labels SafraTree<W>::GetMarkedLabels() {
 
-    if (GetStates() == EMPTY_SET) {
-        return;
-    }
-
-    for (SafraNode *child : GetChildren()) {
-        all_children_states = Union(all_children_states, child->GetStates());
+    Labels marked_labels;
+    for (int node = 0; node < num_nodes_; node++) {
+        if (nodes_[node].marked) {
+            marked_labels.Insert(nodes_[node].label);
+        }
     }
+    return marked_labels;
+}
 
-    int64_t this_node_states = GetStates();
+template <int W>
+const typename SafraTree<W>::Labels &SafraTree<W>::GetRenamedLabels() {
+    return renamed_labels_;
+}
 
-    if (this_node_states == all_children_states) {
 
-        // Mark parent, kill children        
-        SetMarked(true);
+// ============================== Node helpers ============================== //
 
-        for (SafraNode *child : children_) {
-            delete child;
-        }
-        children_.clear();
-    }
-    else {
-        for (SafraNode *child : GetChildren()) {
-            child->VerticalMergeNodeLevel();
+/*
+ * Appends a new node with a fresh label as the rightmost child of parent (or
+ *   as the root if parent is NO_NODE), returning its index.
+ */
+template <int W>
+int SafraTree<W>::AddNode(const States &states, const bool &marked,
+    const int &parent) {
+
+    assert(num_nodes_ < arena_->GetCapacity());
+
+    int node = num_nodes_++;
+    nodes_[node].states = states;
+    nodes_[node].label = GetNewLabel();
+    nodes_[node].marked = marked;
+    nodes_[node].parent = parent;
+    nodes_[node].first_child = NO_NODE;
+    nodes_[node].next_sibling = NO_NODE;
+
+    if (parent != NO_NODE) {
+        int *link = &nodes_[parent].first_child;
+        while (*link != NO_NODE) {
+            link = &nodes_[*link].next_sibling;
         }
+        *link = node;
     }
+
+    return node;
 }
 
+/*
+ * Returns the node after i's subtree in a preorder walk of subtree_root's
+ *   subtree, or NO_NODE if i's subtree is the last part of it.
+ */
+template <int W>
+int SafraTree<W>::SkipSubtree(const int &i, const int &subtree_root) {
 
-void SafraTree::VerticalMerge() {
-    GetRoot()->VerticalMergeNodeLevel();
+    int node = i;
+    while (node != subtree_root) {
+        if (nodes_[node].next_sibling != NO_NODE) {
+            return nodes_[node].next_sibling;
+        }
+        node = nodes_[node].parent;
+    }
+    return NO_NODE;
 }
 
+/*
+ * Returns the node after i in a preorder walk of subtree_root's subtree, or
+ *   NO_NODE if i is the last node of that walk. Walking with this instead of
+ *   recursing keeps every traversal free of call-stack depth.
+ */
+template <int W>
+int SafraTree<W>::NextPreorder(const int &i, const int &subtree_root) {
 
-void SafraTree::SafraNode::GetLabelInfoNodeLevel(bool **seen_states) {
-    // working with the assumption that labels can appear a maximum
-    // of once in the tree
-    int this_label = GetLabel();
-
-    if (IsMarked()) {
-        seen_states[this_label][1] = true;
-    } else {
-        seen_states[this_label][0] = true;
+    if (nodes_[i].first_child != NO_NODE) {
+        return nodes_[i].first_child;
     }
+    return SkipSubtree(i, subtree_root);
+}
 
-    for (SafraNode *child : GetChildren()) {
-        child->GetLabelInfoNodeLevel(seen_states);
+/*
+ * Returns the labels of every node in i's subtree to the unused label pool.
+ *   The nodes themselves stay in the array until the next Compact.
+ */
+template <int W>
+void SafraTree<W>::ReleaseSubtree(const int &i) {
+    for (int node = i; node != NO_NODE; node = NextPreorder(node, i)) {
+        RemoveLabel(nodes_[node].label);
     }
 }
 
-/* 
- * This is used to calculate the final accepting Rabin pairs.
- * This method takes in a tree and the number of possible labels
- * It then returns an array of two boolean arrays: B
- *      - B[i][0] is true if i is in the tree but not marked
- *      - B[i][1] is true if i is the the tree and is marked
+/*
+ * Rewrites the node array so that exactly the nodes reachable from the root
+ *   are stored, in preorder. In preorder a node's first child (if any) is the
+ *   node right after it, which the encoding & string methods rely on.
  */
-bool **SafraTree::GetLabelInfo(int num_labels) {
-    SafraNode *root = GetRoot();
+template <int W>
+void SafraTree<W>::Compact() {
 
-    bool **seen_states = new bool *[num_labels];
+    Node *scratch = arena_->GetScratchNodes();
+    int *new_index = arena_->GetScratchIndices();
 
-    for (int i = 0; i < num_labels; i++) {
-        seen_states[i] = new bool[2];
-        seen_states[i][0] = false;
-        seen_states[i][1] = false;
+    int count = 0;
+    for (int node = 0; node != NO_NODE; node = NextPreorder(node, 0)) {
+        new_index[node] = count;
+        scratch[count++] = nodes_[node];
     }
-    root->GetLabelInfoNodeLevel(seen_states);
 
-    return seen_states;
+    for (int node = 0; node < count; node++) {
+        Node &n = scratch[node];
+        if (n.parent != NO_NODE) { n.parent = new_index[n.parent]; }
+        if (n.first_child != NO_NODE) { n.first_child = new_index[n.first_child]; }
+        if (n.next_sibling != NO_NODE) { n.next_sibling = new_index[n.next_sibling]; }
+    }
+
+    memcpy(nodes_, scratch, count * sizeof(Node));
+    num_nodes_ = count;
 }
 
 
 // ========================= Private helper methods ========================= //
 
-int64_t SafraTree::Transition(const int &state, const int &character) {
-    assert(character * num_states_ + state < transition_rule_.size());
-    return transition_rule_[character * num_states_ + state];
+template <int W>
+typename SafraTree<W>::States SafraTree<W>::Transition(const int &state, const int &character) {
+    return automaton_->template GetTransition<W>(state, character);
 }
 
-int SafraTree::GetNewLabel() {
-    int new_label = unused_labels_->top();
-    unused_labels_->pop();
+template <int W>
+int SafraTree<W>::GetNewLabel() {
+    int new_label = unused_labels_.Lowest();
+    assert(new_label >= 0);
+    unused_labels_.Remove(new_label);
 
     return new_label;
 }
 
-void SafraTree::RemoveLabel(int label) {
-    unused_labels_->push(label);
+template <int W>
+void SafraTree<W>::RemoveLabel(int label) {
+    unused_labels_.Insert(label);
 }
 
-int64_t SafraTree::GetFinalStates() {
-    return final_states_;
+template <int W>
+typename SafraTree<W>::States SafraTree<W>::GetFinalStates() {
+    return automaton_->template GetFinalStates<W>();
 }
 
-int64_t SafraTree::GetInitialStates() {
-    return initial_states_;
+template <int W>
+typename SafraTree<W>::States SafraTree<W>::GetInitialStates() {
+    return automaton_->template GetInitialStates<W>();
 }
 
-SafraTree::SafraNode *SafraTree::GetRoot() {
-    return root_;
-}
-
-
-// ========================================================================== //
-// ======================= SAFRA NODE IMPLEMENTATION ======================== //
-// ========================================================================== //
-
-
-// =================== SafraNode Constructor & Destructor =================== //
 
-SafraTree::SafraNode::SafraNode(const int64_t &states, const bool &marked,
-    SafraTree *tree) {
-
-    tree_ = tree;
-    states_ = states;
-    label_ = GetTree()->GetNewLabel();
-    marked_ = marked;
-}
-
-
-SafraTree::SafraNode::SafraNode(SafraNode *other, SafraTree *my_tree) {
+// ============== Set operations for label list implementation ============== //
 
-    tree_ = my_tree;
-    states_ = other->states_;
-    label_ = other->label_;
-    marked_ = other->marked_;
+template <int W>
+typename SafraTree<W>::States SafraTree<W>::Union(const States &x, const States &y) {
+    return States::Union(x, y);
 }
 
-
-SafraTree::SafraNode::~SafraNode() {
-
-    GetTree()->RemoveLabel(GetLabel());
-    for (SafraNode *child : children_) {
-        delete child;
-    }
-    children_.clear();
+template <int W>
+typename SafraTree<W>::States SafraTree<W>::Intersect(const States &x, const States &y) {
+    return States::Intersect(x, y);
 }
 
-
-// ============== Access methods for SafraNode member variables ============= //
-
-int64_t SafraTree::SafraNode::GetStates() {
-    return states_;
+template <int W>
+typename SafraTree<W>::States SafraTree<W>::Complement(const States &x) {
+    return States::Complement(x);
 }
 
-void SafraTree::SafraNode::SetStates(const int64_t &states) {
-    states_ = states;
+template <int W>
+typename SafraTree<W>::States SafraTree<W>::Difference(const States &x, const States &y) {
+    return States::Difference(x, y);
 }
 
-int SafraTree::SafraNode::GetLabel() {
-    return label_;
+template <int W>
+bool SafraTree<W>::Contains(const States &x, const int &i) {
+    return x.Contains(i);
 }
 
-void SafraTree::SafraNode::SetLabel(const int &label) {
-    label_ = label;
+template <int W>
+typename SafraTree<W>::States SafraTree<W>::Insert(const States &x, const int &i) {
+    States result = x;
+    result.Insert(i);
+    return result;
 }
 
-bool SafraTree::SafraNode::IsMarked() {
-    return marked_;
+template <int W>
+typename SafraTree<W>::States SafraTree<W>::Remove(const States &x, const int &i) {
+    States result = x;
+    result.Remove(i);
+    return result;
 }
 
-void SafraTree::SafraNode::SetMarked(const bool &marked) {
-    marked_ = marked;
-}
+// =================== Binary encoding of a Safra tree ====================== //
 
-std::vector<SafraTree::SafraNode *> &SafraTree::SafraNode::GetChildren() {
-    return children_;
-}
+/*
+ * Writes the canonical compact encoding of this tree into key (replacing its
+ *   contents) and returns the encoding's hash. Every node, in preorder, writes
+ *   the varints
+ *
+ *     label, marked | renamed << 1 | (number of children) << 2, |states|,
+ *
+ *   followed by the gaps between consecutive members of its state set (the
+ *   first member counting from -1). The child counts make the sequence decode
+ *   to exactly one tree, and a node over a few nearby states takes a handful
+ *   of bytes instead of a whole state set. Two trees have equal encodings iff
+ *   they have equal string representations. The hash folds in every value
+ *   written, in order, so it can be recomputed from the key alone.
+ */
+template <int W>
+uint64_t SafraTree<W>::Encode(std::vector<uint8_t> &key) {
 
-void SafraTree::SafraNode::AppendChild(SafraNode *child) {
-    if (child == this) {
-        // ERROR: Node cannot be its own child
-        return;
-    }
-    children_.push_back(child);
-}
+    key.clear();
+    uint64_t hash = HASH_SEED;
 
-void SafraTree::SafraNode::EraseChild(const int &i) {
+    for (int node = 0; node < num_nodes_; node++) {
 
-    assert(i < children_.size());
+        uint64_t num_children = 0;
+        for (int child = nodes_[node].first_child; child != NO_NODE;
+            child = nodes_[child].next_sibling) {
+            num_children++;
+        }
 
-    delete children_[i];
-    children_.erase(children_.begin() + i);
-}
+        uint64_t label = nodes_[node].label;
+        uint64_t flags = (uint64_t) nodes_[node].marked |
+            ((uint64_t) renamed_labels_.Contains(nodes_[node].label) << 1) |
+            (num_children << 2);
+        uint64_t count = nodes_[node].states.Count();
+
+        WriteVarint(key, label);
+        WriteVarint(key, flags);
+        WriteVarint(key, count);
+        hash = HashWord(HashWord(HashWord(hash, label), flags), count);
+
+        int previous = -1;
+        for (int w = 0; w < W; w++) {
+            uint64_t word = nodes_[node].states.GetWord(w);
+            while (word != 0) {
+                int state = w * BITS_PER_WORD + LowestBit(word);
+                word &= word - 1;
+
+                uint64_t gap = state - previous - 1;
+                WriteVarint(key, gap);
+                hash = HashWord(hash, gap);
+                previous = state;
+            }
+        }
+    }
 
-SafraTree *SafraTree::SafraNode::GetTree() {
-    return tree_;
+    return hash;
 }
 
 
-// ============== Set operations for label list implementation ============== //
-
-int64_t SafraTree::Union(const int64_t &x, const int64_t &y) {
-    return x | y;
-}
+/*
+ * Replaces this tree's nodes & labels with the tree encoded in key (as written
+ *   by Encode for a tree over the same automaton). Each node's parent is the
+ *   nearest earlier node on the path up from the previous node that still
+ *   expects children, and the node passed over just below it, if any, is its
+ *   previous sibling.
+ */
+template <int W>
+void SafraTree<W>::Decode(const uint8_t *key, const int &length) {
+
+    const uint8_t *end = key + length;
+    int *remaining_children = arena_->GetScratchIndices();
+    int num_labels = 2 * automaton_->GetNumStates();
+
+    num_nodes_ = 0;
+    renamed_labels_ = Labels();
+    unused_labels_ = Labels();
+    for (int label = 0; label < num_labels; label++) {
+        unused_labels_.Insert(label);
+    }
 
-int64_t SafraTree::Intersect(const int64_t &x, const int64_t &y) {
-    return x & y;
-}
+    while (key < end) {
+        int label = (int) ReadVarint(key);
+        uint64_t flags = ReadVarint(key);
+        int count = (int) ReadVarint(key);
 
-int64_t SafraTree::Complement(const int64_t &x) {
-    return ~x;
-}
+        States states;
+        int state = -1;
+        for (int k = 0; k < count; k++) {
+            state += (int) ReadVarint(key) + 1;
+            states.Insert(state);
+        }
 
-int64_t SafraTree::Difference(const int64_t &x, const int64_t &y) {
-    return x & (~y);
-}
+        int parent = num_nodes_ - 1;
+        int previous_sibling = NO_NODE;
+        while (parent != NO_NODE && remaining_children[parent] == 0) {
+            previous_sibling = parent;
+            parent = nodes_[parent].parent;
+        }
 
-bool SafraTree::Contains(const int64_t &x, const int &i) {
-    return ((x << i) & 1) == 1;
-}
+        assert(num_nodes_ < arena_->GetCapacity());
+        int node = num_nodes_++;
+        nodes_[node].states = states;
+        nodes_[node].label = label;
+        nodes_[node].marked = flags & 1;
+        nodes_[node].parent = parent;
+        nodes_[node].first_child = NO_NODE;
+        nodes_[node].next_sibling = NO_NODE;
+        remaining_children[node] = (int) (flags >> 2);
+
+        if (parent != NO_NODE) {
+            remaining_children[parent]--;
+            if (previous_sibling == NO_NODE) {
+                nodes_[parent].first_child = node;
+            }
+            else {
+                nodes_[previous_sibling].next_sibling = node;
+            }
+        }
 
-int64_t SafraTree::Insert(const int64_t &x, const int &i) {
-    return x | (1 << i);
+        unused_labels_.Remove(label);
+        if (flags & 2) {
+            renamed_labels_.Insert(label);
+        }
+    }
 }
 
-int64_t SafraTree::Remove(const int64_t &x, const int &i) {
-    return x & (~(1 << i));
-}
 
-// ================ String methods for SafraTree & SafraNode ================ //
+// ======================= String methods for SafraTree ====================== //
 
 /*
  * Writes out the string representation of a Safra node
  */
-std::string SafraTree::SafraNode::ToString() {
+template <int W>
+std::string SafraTree<W>::NodeToString(const int &i) {
     std::ostringstream stream;
 
-    stream << GetLabel()+1 << ":{";
+    stream << nodes_[i].label+1 << ":{";
     int first = true;
-    for (int i = 0; i < tree_->num_states_; i++) {
-        if (((states_ >> i) & 1) == 1) {
+    for (int s = 0; s < automaton_->GetNumStates(); s++) {
+        if (nodes_[i].states.Contains(s)) {
             if (!first) { stream << ","; }
             else { first = false; }
-            stream << i+1;
+            stream << s+1;
         }
     }
     stream << "}";
-    if (IsMarked()) {
+    if (nodes_[i].marked) {
         stream << "!";
     }
+    if (renamed_labels_.Contains(nodes_[i].label)) {
+        stream << "~";
+    }
     return stream.str();
 }
 
 
 /*
- * Recursive helper method for writing the string representation of a single
- *   Safra tree based on a given node's children
+ * Writes out the string representation of a Safra tree: the root, then for
+ *   every node in preorder, the list of that node's children
  */
-std::string SafraTree::SafraNode::StringifyChildren() {
+template <int W>
+std::string SafraTree<W>::ToString() {
 
     std::ostringstream stream;
+    stream << "(" << NodeToString(0);
 
-    for (SafraNode *child : GetChildren()) {
-        stream << "; " << child->ToString();
-    }
-    for (SafraNode *child : GetChildren()) {
-        stream << child->StringifyChildren();
+    for (int node = 0; node < num_nodes_; node++) {
+        for (int child = nodes_[node].first_child; child != NO_NODE;
+            child = nodes_[child].next_sibling) {
+            stream << "; " << NodeToString(child);
+        }
     }
+
+    stream << ")";
     return stream.str();
 }
 
 
 /*
- * Writes out the string representation of a Safra tree
+ * Writes the string representation of a Safra node to out, walking only the
+ *   members of its state set
  */
-std::string SafraTree::ToString() {
+template <int W>
+void SafraTree<W>::WriteNode(OutputBuffer &out, const int &i) {
 
-    std::ostringstream stream;
-    stream << "(" << root_->ToString() << root_->StringifyChildren() << ")";
-    return stream.str();
-}
\ No newline at end of file
+    out.WriteInt(nodes_[i].label+1);
+    out.Write(":{", 2);
+
+    bool first = true;
+    for (int w = 0; w < W; w++) {
+        uint64_t word = nodes_[i].states.GetWord(w);
+        while (word != 0) {
+            if (!first) { out.WriteChar(','); }
+            else { first = false; }
+            out.WriteInt(w * BITS_PER_WORD + LowestBit(word) + 1);
+            word &= word - 1;
+        }
+    }
+
+    out.WriteChar('}');
+    if (nodes_[i].marked) {
+        out.WriteChar('!');
+    }
+    if (renamed_labels_.Contains(nodes_[i].label)) {
+        out.WriteChar('~');
+    }
+}
+
+
+/*
+ * Writes the same text as ToString to out, without building any strings
+ */
+template <int W>
+void SafraTree<W>::WriteTo(OutputBuffer &out) {
+
+    out.WriteChar('(');
+    WriteNode(out, 0);
+
+    for (int node = 0; node < num_nodes_; node++) {
+        for (int child = nodes_[node].first_child; child != NO_NODE;
+            child = nodes_[child].next_sibling) {
+            out.Write("; ", 2);
+            WriteNode(out, child);
+        }
+    }
+
+    out.WriteChar(')');
+}
+
+
+// ========================================================================== //
+// ====================== SAFRA ARENA IMPLEMENTATION ======================== //
+// ========================================================================== //
+
+template <int W>
+SafraArena<W>::SafraArena(int capacity, const SafraAllocator &allocator) {
+    assert(allocator.IsValid());
+    capacity_ = 0;
+    trees_per_chunk_ = 0;
+    allocator_ = allocator;
+    Reset(capacity);
+}
+
+template <int W>
+SafraArena<W>::~SafraArena() {
+    FreeChunks();
+}
+
+/*
+ * Arrays keep their old size when it is large enough, so a run over a smaller
+ *   automaton reuses every chunk of the previous one
+ */
+template <int W>
+void SafraArena<W>::Reset(int capacity) {
+
+    assert(free_list_.size() == chunks_.size() * trees_per_chunk_);
+
+    if (capacity <= capacity_) {
+        return;
+    }
+
+    FreeChunks();
+
+    capacity_ = capacity;
+    trees_per_chunk_ = std::max<int>(1,
+        ARENA_CHUNK_BYTES / (capacity_ * sizeof(SafraNode<W>)));
+    scratch_nodes_ = std::vector<SafraNode<W>>(capacity);
+    scratch_indices_ = std::vector<int>(capacity);
+    scratch_states_ = std::vector<StateSet<W>>(capacity);
+}
+
+template <int W>
+void SafraArena<W>::FreeChunks() {
+    for (SafraNode<W> *chunk : chunks_) {
+        if (allocator_.allocate != NULL) {
+            allocator_.deallocate(chunk,
+                sizeof(SafraNode<W>) * capacity_ * trees_per_chunk_,
+                allocator_.context);
+        }
+        else {
+            delete[] chunk;
+        }
+    }
+    chunks_.clear();
+    free_list_.clear();
+}
+
+/*
+ * Returns an array of GetCapacity() nodes, taking a new chunk from the system
+ *   allocator only when every previously handed-out array is still in use.
+ */
+template <int W>
+SafraNode<W> *SafraArena<W>::Allocate() {
+
+    if (free_list_.empty()) {
+        SafraNode<W> *chunk;
+
+        if (allocator_.allocate != NULL) {
+            void *memory = allocator_.allocate(
+                sizeof(SafraNode<W>) * capacity_ * trees_per_chunk_,
+                allocator_.context);
+            if (memory == NULL) {
+                throw std::bad_alloc();
+            }
+
+            // Nodes are plain data, so constructing them is just zeroing
+            chunk = static_cast<SafraNode<W> *>(memory);
+            for (int i = 0; i < capacity_ * trees_per_chunk_; i++) {
+                new (&chunk[i]) SafraNode<W>();
+            }
+        }
+        else {
+            chunk = new SafraNode<W>[capacity_ * trees_per_chunk_];
+        }
+        chunks_.push_back(chunk);
+
+        for (int i = trees_per_chunk_ - 1; i >= 0; i--) {
+            free_list_.push_back(chunk + i * capacity_);
+        }
+    }
+
+    SafraNode<W> *nodes = free_list_.back();
+    free_list_.pop_back();
+    return nodes;
+}
+
+template <int W>
+void SafraArena<W>::Release(SafraNode<W> *nodes) {
+    free_list_.push_back(nodes);
+}
+
+template <int W>
+int SafraArena<W>::GetCapacity() {
+    return capacity_;
+}
+
+template <int W>
+SafraNode<W> *SafraArena<W>::GetScratchNodes() {
+    return &scratch_nodes_[0];
+}
+
+template <int W>
+int *SafraArena<W>::GetScratchIndices() {
+    return &scratch_indices_[0];
+}
+
+template <int W>
+StateSet<W> *SafraArena<W>::GetScratchStates() {
+    return &scratch_states_[0];
+}
+
+template <int W>
+StateSet<W> *SafraArena<W>::GetScratchImages(const int &count) {
+    if ((int) scratch_images_.size() < count) {
+        scratch_images_.resize(count);
+    }
+    return &scratch_images_[0];
+}
+
+
+// Explicit instantiations for every supported state set width
+#define INSTANTIATE_SAFRA_TREE(W) template class SafraTree<W>; \
+    template class SafraArena<W>;
+SAFRA_FOR_EACH_WIDTH(INSTANTIATE_SAFRA_TREE)
+#undef INSTANTIATE_SAFRA_TREE
@@ -17,121 +17,188 @@
 #include <iostream>
 #include <string>
 #include <cstdint>
-#include <queue>
 #include <string>
 
-class SafraTree {
-public:
-
-    // Standard constructor, copy constructor, & destructor
-    SafraTree(int num_states, int alphabet_size,
-        std::vector<int64_t> transition, int64_t initial_states,
-        int64_t final_states);
-    SafraTree(SafraTree *original, const int &character);
-    ~SafraTree();
-
-    void UnmarkAndUpdateAll(const int &c);
-
-    // Public methods for each step of the algorithm
-    void UnmarkAllNodes();              // (1)
-    void UpdateStateSets(const int &c); // (2)
-    void AttachChildren();              // (3)
-    void HorizontalMerge();             // (4)
-    void KillEmptyNodes();              // (5)
-    void VerticalMerge();               // (6)
-
-    // For getting Rabin Pairs
-    bool** GetLabelInfo(int num_labels);
-
-    // ToString method
-    std::string ToString();
-
-private:
+#include "state_set.h"
+#include "buechi_automaton.h"
+#include "tree_table.h"
+#include "output_buffer.h"
+#include "safra_allocator.h"
+
+// Marks a missing parent / child / sibling link in a flat Safra tree
+#define NO_NODE -1
+
+/*
+ * A single node of a flat Safra tree. The nodes of a tree live in one
+ *   contiguous array, and the tree structure is given by indices into that
+ *   array rather than pointers, so a whole tree can be copied with memcpy.
+ */
+template <int W>
+struct SafraNode {
+    StateSet<W> states;
+    int label;
+    bool marked;
+    int parent;
+    int first_child;
+    int next_sibling;
+};
 
-    // ===== Safra node class definition =====
 
-    class SafraNode {
-    public:
+/*
+ * Hands out fixed-size node arrays for the trees of one exploration. Every
+ *   tree over the same automaton has the same capacity (2n nodes, one per
+ *   label), so arrays are carved out of chunks of about 64 KiB (at least
+ *   one array each) and recycled through a free list instead of going through
+ *   the general-purpose allocator. The chunks themselves come from allocator,
+ *   which must set both of its hooks or neither.
+ */
+template <int W>
+class SafraArena {
+public:
 
-        // Constructor & Destructor
-        SafraNode(const int64_t &states, const bool &marked, SafraTree *tree);
-        SafraNode(SafraNode *other, SafraTree *my_tree);
-        ~SafraNode();
+    SafraArena(int capacity, const SafraAllocator &allocator);
+    ~SafraArena();
 
-        // Access methods for member variables
-        int64_t GetStates();
-        void SetStates(const int64_t &states);
+    // Readies the arena for trees of up to capacity nodes, once every array
+    //   has been released. Chunks are kept if their arrays are large enough.
+    void Reset(int capacity);
 
-        int GetLabel();
-        void SetLabel(const int &label);
+    SafraNode<W> *Allocate();
+    void Release(SafraNode<W> *nodes);
 
-        bool IsMarked();
-        void SetMarked(const bool &marked);
+    int GetCapacity();
 
-        std::vector<SafraNode *> &GetChildren();
-        void AppendChild(SafraNode *child);
-        void EraseChild(const int &i);
+    // Scratch space shared by all trees of this arena, used while rebuilding
+    //   a tree's node array in preorder or merging its nodes
+    SafraNode<W> *GetScratchNodes();
+    int *GetScratchIndices();
+    StateSet<W> *GetScratchStates();
+    StateSet<W> *GetScratchImages(const int &count);
 
-        SafraTree *GetTree();
+private:
+    int capacity_;
+    int trees_per_chunk_;
+    SafraAllocator allocator_;
+    std::vector<SafraNode<W> *> chunks_;
+    std::vector<SafraNode<W> *> free_list_;
+
+    void FreeChunks();
+
+    std::vector<SafraNode<W>> scratch_nodes_;
+    std::vector<int> scratch_indices_;
+    std::vector<StateSet<W>> scratch_states_;
+    std::vector<StateSet<W>> scratch_images_;
+};
 
-        std::string ToString();
-        std::string StringifyChildren();
 
-        void RecursiveRemoveFromStates(int64_t r_states);
+/*
+ * A Safra tree over a Buechi automaton whose state sets fit in W 64-bit words.
+ *   The automaton itself is shared: a tree only holds a pointer to it along
+ *   with its own node data.
+ *   The tree is instantiated for every width in SAFRA_FOR_EACH_WIDTH, and the
+ *   caller picks the width at runtime using StateWordsFor(num_states).
+ *
+ * Between operations the nodes are stored in preorder with the root at index
+ *   0, so most passes over the tree are plain loops over the node array.
+ */
+template <int W>
+class SafraTree {
+public:
 
-        void UnmarkAndUpdate(const int &c);
+    typedef StateSet<W> States;
+    typedef SafraNode<W> Node;
 
-        // Methods for steps of Safra's Algorithm
-        void UnmarkAll();
-        void TransitionStates(const int &c);
-        void CreateChild();
-        void AttachChildrenToAllNodes();
-        void HorizontalMergeNodeLevel();
-        void HorizontalMergeAllNodes();
-        void KillEmptyNodesNodeLevel();
-        void VerticalMergeNodeLevel();
+    // Labels range over [0, 2n), so a set of labels needs twice the width of
+    //   a set of states
+    typedef StateSet<2 * W> Labels;
 
-        // For getting RabinPairs
-        void GetLabelInfoNodeLevel(bool **state_info);
+    // Standard constructor, copy constructor, & destructor. With
+    //   canonical_labels, every tree reached from this one has its labels
+    //   renamed after each transition (see CanonicalizeLabels).
+    SafraTree(SafraArena<W> *arena, const BuchiAutomaton *automaton,
+        const bool &canonical_labels);
+    SafraTree(SafraArena<W> *arena, SafraTree *original, const int &character);
+    ~SafraTree();
 
-    private:
-        // Member variables
-        int64_t states_;
-        int label_;
-        bool marked_;
-        std::vector<SafraNode *> children_;
-        SafraTree *tree_;
-    };
+    // Computes the successor of this tree along every character at once:
+    //   successors holds |Sigma| trees over the same automaton, & successors[c]
+    //   is overwritten with the tree SafraTree(arena, this, c) would build
+    void GetSuccessors(const std::vector<SafraTree *> &successors);
 
-    // Member variables representing Buchi automaton
-    int64_t initial_states_;
-    int64_t final_states_;
-    int num_states_;
-    std::vector<int64_t> transition_rule_;
+    // Public methods for each step of the algorithm
+    void UnmarkAndUpdateAll(const int &c); // (1) & (2)
+    void AttachChildren();                 // (3)
+    void MergeAndPrune();                  // (4) - (6) in a single pass
+
+    // Size of the tree (for --stats): number of nodes, and number of nodes on
+    //   the longest root-to-leaf path
+    int GetNumNodes();
+    int GetDepth();
+
+    // For getting Rabin Pairs. Renamed labels (always empty unless labels are
+    //   canonical) belong to a different node than in the previous tree, so
+    //   they count as unused for the pairs.
+    const Labels &GetUnusedLabels();
+    Labels GetMarkedLabels();
+    const Labels &GetRenamedLabels();
+
+    // Canonical compact encoding (the dedup key, & how explored trees are
+    //   stored) & its 64-bit hash, & the inverse: replaces this tree with the
+    //   one encoded in key
+    uint64_t Encode(std::vector<uint8_t> &key);
+    void Decode(const uint8_t *key, const int &length);
+
+    // ToString method, & the same text written straight into an output file
+    std::string ToString();
+    void WriteTo(OutputBuffer &out);
 
-    SafraNode *root_;
-    std::priority_queue<int, std::vector<int>, std::greater<int>> *unused_labels_;
+private:
 
-    // root access method
-    SafraNode *GetRoot();
+    // Buchi automaton shared by every tree of the run
+    const BuchiAutomaton *automaton_;
+
+    // Node storage: nodes_[0 .. num_nodes_) taken from arena_
+    SafraArena<W> *arena_;
+    Node *nodes_;
+    int num_nodes_;
+
+    // Labels not used by any node of the tree. The lowest one is handed out
+    //   first, so labels are assigned exactly as with a min-heap.
+    Labels unused_labels_;
+
+    // Whether labels are renamed to their age rank after every transition,
+    //   and the labels that this renaming moved to another node
+    bool canonical_labels_;
+    Labels renamed_labels_;
+
+    // Copy of original's nodes and labels, before any step
+    SafraTree(SafraArena<W> *arena, SafraTree *original);
+    void CopyFrom(SafraTree *original);
+    void FinishTransition();
+    void CanonicalizeLabels();
+
+    // Node helpers
+    int AddNode(const States &states, const bool &marked, const int &parent);
+    int SkipSubtree(const int &i, const int &subtree_root);
+    int NextPreorder(const int &i, const int &subtree_root);
+    void ReleaseSubtree(const int &i);
+    void Compact();
+    std::string NodeToString(const int &i);
+    void WriteNode(OutputBuffer &out, const int &i);
 
     // Private helper methods
-    int64_t Transition(const int &state, const int &character);
+    States Transition(const int &state, const int &character);
     int GetNewLabel();
     void RemoveLabel(int label);
-    int64_t GetInitialStates();
-    int64_t GetFinalStates();
-    void CopyChildren(SafraNode *node, SafraNode *other_node,
-        std::unordered_set<int> &used_labels);
+    States GetInitialStates();
+    States GetFinalStates();
 
     // Implementation of set functions using bitvector implementation
-    static int64_t Union(const int64_t &x, const int64_t &y);
-    static int64_t Intersect(const int64_t &x, const int64_t &y);
-    static int64_t Complement(const int64_t &x);
-    static int64_t Difference(const int64_t &x, const int64_t &y);
-    static bool Contains(const int64_t &x, const int &i);
-    static int64_t Insert(const int64_t &x, const int &i);
-    static int64_t Remove(const int64_t &x, const int &i);
+    static States Union(const States &x, const States &y);
+    static States Intersect(const States &x, const States &y);
+    static States Complement(const States &x);
+    static States Difference(const States &x, const States &y);
+    static bool Contains(const States &x, const int &i);
+    static States Insert(const States &x, const int &i);
+    static States Remove(const States &x, const int &i);
 };
-
-
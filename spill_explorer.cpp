@@ -0,0 +1,827 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *  spill_explorer.cpp - exploration of the Safra trees in external memory    *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <utility>
+
+#include <unistd.h>
+
+#include "spill_explorer.h"
+#include "rabin_writer.h"
+
+// Smallest write buffer of a spill file
+#define MIN_SPILL_CHUNK_SIZE (1 << 12)
+
+typedef std::chrono::steady_clock Clock;
+
+static double MillisecondsSince(const Clock::time_point &start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/*
+ * Sets error to say that file could not be read / written, & returns false
+ */
+static bool SpillError(SpillFile &file, const char *action, std::string &error) {
+    error = std::string("cannot ") + action + " spill file " + file.GetPath();
+    return false;
+}
+
+// Merge order of the per-partition streams: the smallest sequence number first
+typedef std::pair<uint64_t, int> MergeHead;
+typedef std::priority_queue<MergeHead, std::vector<MergeHead>,
+    std::greater<MergeHead>> MergeQueue;
+
+
+// ============================== SpillFile ================================= //
+
+SpillFile::SpillFile() {
+    out_ = NULL;
+    size_ = 0;
+    exists_ = false;
+}
+
+SpillFile::~SpillFile() {
+    Remove();
+}
+
+void SpillFile::SetPath(const std::string &path) {
+    path_ = path;
+}
+
+bool SpillFile::Create(const size_t &chunk_size) {
+    Close();
+    out_ = new OutputBuffer(chunk_size);
+    exists_ = true;
+    size_ = 0;
+    return out_->Open(path_.c_str());
+}
+
+bool SpillFile::Append(const size_t &chunk_size) {
+    Close();
+    out_ = new OutputBuffer(chunk_size);
+    exists_ = true;
+    return out_->OpenForAppend(path_.c_str());
+}
+
+bool SpillFile::Close() {
+    if (out_ == NULL) {
+        return true;
+    }
+    bool ok = out_->Close();
+    delete out_;
+    out_ = NULL;
+    return ok;
+}
+
+bool SpillFile::Map(MappedFile &file) {
+    return file.Open(path_.c_str());
+}
+
+uint64_t SpillFile::GetSize() {
+    return size_;
+}
+
+const std::string &SpillFile::GetPath() {
+    return path_;
+}
+
+void SpillFile::Remove() {
+    Close();
+    if (exists_) {
+        unlink(path_.c_str());
+        exists_ = false;
+    }
+    size_ = 0;
+}
+
+
+// ===================== Constructor, destructor & Run ====================== //
+
+template <int W>
+SpillExplorer<W>::SpillExplorer(const BuchiAutomaton *automaton,
+    bool canonical_labels, const size_t &memory_budget,
+    const char *spill_directory)
+    : arena_(2*automaton->GetNumStates(), SafraAllocator()) {
+
+    automaton_ = automaton;
+    canonical_labels_ = canonical_labels;
+    memory_budget_ = (memory_budget > 0 ? memory_budget : DEFAULT_MEMORY_BUDGET);
+    spill_directory_ = spill_directory;
+
+    scratch_tree_ = new SafraTree<W>(&arena_, automaton_, canonical_labels_);
+    for (int c = 0; c < automaton_->GetAlphabetSize(); c++) {
+        successor_trees_.push_back(new SafraTree<W>(&arena_, automaton_,
+            canonical_labels_));
+    }
+
+    partition_bits_ = 0;
+    level_start_ = 0;
+    num_states_ = 0;
+    frontier_offset_ = 0;
+
+    tree_file_.SetPath(SpillPath("trees", 0));
+    label_file_.SetPath(SpillPath("labels", 0));
+    transition_file_.SetPath(SpillPath("transitions", 0));
+
+    stats_ = ExplorerStats();
+    for (int i = 0; i < 2*automaton_->GetNumStates(); i++) {
+        never_used_labels_.Insert(i);
+    }
+}
+
+template <int W>
+SpillExplorer<W>::~SpillExplorer() {
+
+    // Each SpillFile removes its file
+    for (Partition *partition : partitions_) {
+        delete partition;
+    }
+    for (LevelFiles *files : level_files_) {
+        delete files;
+    }
+
+    delete scratch_tree_;
+    for (SafraTree<W> *tree : successor_trees_) {
+        delete tree;
+    }
+}
+
+
+/*
+ * Writes the initial tree as state 0, then processes one BFS level after
+ *   another until a level finds no new tree.
+ */
+template <int W>
+bool SpillExplorer<W>::Run(std::string &error) {
+
+    Clock::time_point start = Clock::now();
+    double expand_ms = 0;
+
+    SafraTree<W> initial_tree(&arena_, automaton_, canonical_labels_);
+    uint64_t hash = initial_tree.Encode(key_);
+    uint32_t initial_id = 0;
+
+    Partition *partition = new Partition();
+    partition->trees.SetPath(SpillPath("index0-trees", 0));
+    partition->ids.SetPath(SpillPath("index0-ids", 0));
+    partitions_.push_back(partition);
+
+    if (!partition->trees.Create(ChunkSize())) {
+        return SpillError(partition->trees, "create", error);
+    }
+    partition->trees.Write(&hash, sizeof(hash));
+    partition->trees.WriteVarint(key_.size());
+    partition->trees.Write(&key_[0], key_.size());
+    if (!partition->trees.Close()) {
+        return SpillError(partition->trees, "write", error);
+    }
+
+    if (!partition->ids.Create(ChunkSize())) {
+        return SpillError(partition->ids, "create", error);
+    }
+    partition->ids.Write(&initial_id, sizeof(initial_id));
+    if (!partition->ids.Close()) {
+        return SpillError(partition->ids, "write", error);
+    }
+
+    if (!tree_file_.Create(ChunkSize())) {
+        return SpillError(tree_file_, "create", error);
+    }
+    tree_file_.WriteVarint(key_.size());
+    tree_file_.Write(&key_[0], key_.size());
+    if (!tree_file_.Close()) {
+        return SpillError(tree_file_, "write", error);
+    }
+
+    if (!label_file_.Create(ChunkSize())) {
+        return SpillError(label_file_, "create", error);
+    }
+    if (!transition_file_.Create(ChunkSize())) {
+        return SpillError(transition_file_, "create", error);
+    }
+
+    stats_.trees_generated = 1;
+    level_start_ = 0;
+    num_states_ = 1;
+    frontier_offset_ = 0;
+
+    while (level_start_ < num_states_) {
+
+        Clock::time_point level = Clock::now();
+        if (!ExpandLevel(error)) {
+            return false;
+        }
+        expand_ms += MillisecondsSince(level);
+
+        stats_.table_entries = 0;
+        stats_.table_slots = 0;
+        for (int p = 0; p < (int) partitions_.size(); p++) {
+            if (!ResolvePartition(p, error)) {
+                return false;
+            }
+        }
+
+        if (!NumberNewTrees(error) || !MergeTransitions(error) ||
+            !SplitPartitions(error)) {
+            return false;
+        }
+    }
+
+    if (!label_file_.Close()) {
+        return SpillError(label_file_, "write", error);
+    }
+    if (!transition_file_.Close()) {
+        return SpillError(transition_file_, "write", error);
+    }
+
+    // The level files are only needed while a level is processed
+    for (LevelFiles *files : level_files_) {
+        delete files;
+    }
+    level_files_.clear();
+
+    stats_.explore_ms = expand_ms;
+    stats_.renumber_ms = MillisecondsSince(start) - expand_ms;
+    stats_.dedup_misses = num_states_;
+    stats_.dedup_hits = stats_.trees_generated - stats_.dedup_misses;
+    return true;
+}
+
+
+// ============================ Access methods ============================== //
+
+template <int W>
+ExplorerStats SpillExplorer<W>::GetStats() {
+    ExplorerStats stats = stats_;
+    stats.labels_available = 2*automaton_->GetNumStates();
+    stats.labels_used = stats.labels_available - never_used_labels_.Count();
+    return stats;
+}
+
+template <int W>
+int SpillExplorer<W>::GetNumStates() {
+    return num_states_;
+}
+
+
+// ========================== Processing a level ============================ //
+
+/*
+ * (1) Decodes & expands every tree of the frontier, recording its label masks
+ *   and writing its successors to the candidate files. A candidate is its
+ *   sequence number (position of the transition within the level), the hash
+ *   & the length-prefixed encoding of the successor.
+ */
+template <int W>
+bool SpillExplorer<W>::ExpandLevel(std::string &error) {
+
+    int num_partitions = partitions_.size();
+
+    if ((int) level_files_.size() != num_partitions) {
+        for (LevelFiles *files : level_files_) {
+            delete files;
+        }
+        level_files_.clear();
+
+        for (int p = 0; p < num_partitions; p++) {
+            LevelFiles *files = new LevelFiles();
+            files->candidates.SetPath(SpillPath("candidates", p));
+            files->resolved.SetPath(SpillPath("resolved", p));
+            files->new_trees.SetPath(SpillPath("new", p));
+            level_files_.push_back(files);
+        }
+    }
+
+    for (LevelFiles *files : level_files_) {
+        if (!files->candidates.Create(ChunkSize())) {
+            return SpillError(files->candidates, "create", error);
+        }
+    }
+
+    MappedFile trees;
+    if (!tree_file_.Map(trees)) {
+        return SpillError(tree_file_, "read", error);
+    }
+    const uint8_t *data = (const uint8_t *) trees.GetData() + frontier_offset_;
+
+    int alphabet_size = automaton_->GetAlphabetSize();
+    uint64_t sequence = 0;
+
+    for (int state = level_start_; state < num_states_; state++) {
+
+        int length = (int) ReadVarint(data);
+        scratch_tree_->Decode(data, length);
+        data += length;
+        CountTree(scratch_tree_);
+
+        Labels unused_labels = Labels::Union(scratch_tree_->GetUnusedLabels(),
+            scratch_tree_->GetRenamedLabels());
+        Labels marked_labels = scratch_tree_->GetMarkedLabels();
+        label_file_.Write(unused_labels.GetWords(), 2 * W * sizeof(uint64_t));
+        label_file_.Write(marked_labels.GetWords(), 2 * W * sizeof(uint64_t));
+
+        scratch_tree_->GetSuccessors(successor_trees_);
+
+        for (int c = 0; c < alphabet_size; c++) {
+            uint64_t hash = successor_trees_[c]->Encode(key_);
+
+            SpillFile &candidates = level_files_[PartitionOf(hash)]->candidates;
+            candidates.WriteVarint(sequence++);
+            candidates.Write(&hash, sizeof(hash));
+            candidates.WriteVarint(key_.size());
+            candidates.Write(&key_[0], key_.size());
+        }
+        stats_.trees_generated += alphabet_size;
+    }
+
+    // New trees go after the ones expanded here
+    frontier_offset_ = trees.GetSize();
+
+    for (LevelFiles *files : level_files_) {
+        if (!files->candidates.Close()) {
+            return SpillError(files->candidates, "write", error);
+        }
+    }
+    return true;
+}
+
+
+/*
+ * (2) Loads partition p into the table & looks its candidates up. Each
+ *   candidate is resolved to (sequence number, id << 1) if the tree was known
+ *   before this level, and otherwise to (sequence number, k << 1 | 1) for the
+ *   partition's k-th new tree; the first candidate of each new tree is also
+ *   written to the partition's new trees & added to its index.
+ */
+template <int W>
+bool SpillExplorer<W>::ResolvePartition(const int &p, std::string &error) {
+
+    Partition *partition = partitions_[p];
+    LevelFiles *files = level_files_[p];
+
+    MappedFile index, ids, candidates;
+    if (!partition->trees.Map(index)) {
+        return SpillError(partition->trees, "read", error);
+    }
+    if (!partition->ids.Map(ids)) {
+        return SpillError(partition->ids, "read", error);
+    }
+    if (!files->candidates.Map(candidates)) {
+        return SpillError(files->candidates, "read", error);
+    }
+
+    table_.Clear();
+    table_ids_.clear();
+    bool inserted;
+
+    const uint8_t *data = (const uint8_t *) index.GetData();
+    const uint8_t *end = data + index.GetSize();
+    const uint32_t *id = (const uint32_t *) ids.GetData();
+
+    while (data < end) {
+        uint64_t hash;
+        memcpy(&hash, data, sizeof(hash));
+        data += sizeof(hash);
+        int length = (int) ReadVarint(data);
+
+        table_.Insert(data, length, hash, inserted);
+        table_ids_.push_back(*id++);
+        data += length;
+    }
+    int num_known = table_.Size();
+
+    if (!files->resolved.Create(ChunkSize())) {
+        return SpillError(files->resolved, "create", error);
+    }
+    if (!files->new_trees.Create(ChunkSize())) {
+        return SpillError(files->new_trees, "create", error);
+    }
+    if (!partition->trees.Append(ChunkSize())) {
+        return SpillError(partition->trees, "write", error);
+    }
+
+    data = (const uint8_t *) candidates.GetData();
+    end = data + candidates.GetSize();
+
+    while (data < end) {
+        uint64_t sequence = ReadVarint(data);
+        uint64_t hash;
+        memcpy(&hash, data, sizeof(hash));
+        data += sizeof(hash);
+        int length = (int) ReadVarint(data);
+        const uint8_t *key = data;
+        data += length;
+
+        int entry = table_.Insert(key, length, hash, inserted);
+        files->resolved.WriteVarint(sequence);
+
+        if (entry < num_known) {
+            files->resolved.WriteVarint((uint64_t) table_ids_[entry] << 1);
+            continue;
+        }
+
+        files->resolved.WriteVarint(((uint64_t) (entry - num_known) << 1) | 1);
+        if (inserted) {
+            files->new_trees.WriteVarint(sequence);
+            files->new_trees.WriteVarint(length);
+            files->new_trees.Write(key, length);
+
+            partition->trees.Write(&hash, sizeof(hash));
+            partition->trees.WriteVarint(length);
+            partition->trees.Write(key, length);
+        }
+    }
+
+    stats_.table_entries += table_.Size();
+    stats_.table_slots += table_.GetCapacity();
+    stats_.table_lookups += table_.GetNumLookups();
+    stats_.table_probes += table_.GetNumProbes();
+    stats_.table_max_probe = std::max(stats_.table_max_probe,
+        table_.GetMaxProbe());
+
+    if (!files->resolved.Close()) {
+        return SpillError(files->resolved, "write", error);
+    }
+    if (!files->new_trees.Close()) {
+        return SpillError(files->new_trees, "write", error);
+    }
+    if (!partition->trees.Close()) {
+        return SpillError(partition->trees, "write", error);
+    }
+    return true;
+}
+
+
+/*
+ * (3) Merges the partitions' new trees by the sequence number of the
+ *   transition that first reached them, numbering them in that order (as a
+ *   sequential BFS would) & appending them to the tree file, then appends
+ *   each partition's new ids to its index. The new trees are the next
+ *   frontier.
+ */
+template <int W>
+bool SpillExplorer<W>::NumberNewTrees(std::string &error) {
+
+    int num_partitions = partitions_.size();
+
+    std::vector<MappedFile> new_trees(num_partitions);
+    std::vector<const uint8_t *> position(num_partitions);
+    std::vector<const uint8_t *> end(num_partitions);
+    MergeQueue queue;
+
+    for (int p = 0; p < num_partitions; p++) {
+        SpillFile &file = level_files_[p]->new_trees;
+        if (!file.Map(new_trees[p])) {
+            return SpillError(file, "read", error);
+        }
+        position[p] = (const uint8_t *) new_trees[p].GetData();
+        end[p] = position[p] + new_trees[p].GetSize();
+        if (position[p] < end[p]) {
+            queue.push(MergeHead(ReadVarint(position[p]), p));
+        }
+    }
+
+    if (!tree_file_.Append(ChunkSize())) {
+        return SpillError(tree_file_, "write", error);
+    }
+
+    int first_new_state = num_states_;
+    new_ids_.assign(num_partitions, std::vector<uint32_t>());
+
+    while (!queue.empty()) {
+        int p = queue.top().second;
+        queue.pop();
+
+        int length = (int) ReadVarint(position[p]);
+        tree_file_.WriteVarint(length);
+        tree_file_.Write(position[p], length);
+        position[p] += length;
+
+        new_ids_[p].push_back(num_states_++);
+
+        if (position[p] < end[p]) {
+            queue.push(MergeHead(ReadVarint(position[p]), p));
+        }
+    }
+
+    if (!tree_file_.Close()) {
+        return SpillError(tree_file_, "write", error);
+    }
+
+    for (int p = 0; p < num_partitions; p++) {
+        SpillFile &ids = partitions_[p]->ids;
+        if (new_ids_[p].empty()) {
+            continue;
+        }
+        if (!ids.Append(ChunkSize())) {
+            return SpillError(ids, "write", error);
+        }
+        ids.Write(&new_ids_[p][0], new_ids_[p].size() * sizeof(uint32_t));
+        if (!ids.Close()) {
+            return SpillError(ids, "write", error);
+        }
+    }
+
+    level_start_ = first_new_state;
+    return true;
+}
+
+
+/*
+ * (3) Merges the resolved candidates of every partition back into sequence
+ *   order, which is the order of the level's transitions (by source state,
+ *   then letter), & appends their final ids to the transition file.
+ */
+template <int W>
+bool SpillExplorer<W>::MergeTransitions(std::string &error) {
+
+    int num_partitions = partitions_.size();
+
+    std::vector<MappedFile> resolved(num_partitions);
+    std::vector<const uint8_t *> position(num_partitions);
+    std::vector<const uint8_t *> end(num_partitions);
+    MergeQueue queue;
+
+    for (int p = 0; p < num_partitions; p++) {
+        SpillFile &file = level_files_[p]->resolved;
+        if (!file.Map(resolved[p])) {
+            return SpillError(file, "read", error);
+        }
+        position[p] = (const uint8_t *) resolved[p].GetData();
+        end[p] = position[p] + resolved[p].GetSize();
+        if (position[p] < end[p]) {
+            queue.push(MergeHead(ReadVarint(position[p]), p));
+        }
+    }
+
+    while (!queue.empty()) {
+        int p = queue.top().second;
+        queue.pop();
+
+        uint64_t value = ReadVarint(position[p]);
+        uint32_t target = (value & 1 ? new_ids_[p][value >> 1] :
+            (uint32_t) (value >> 1));
+        transition_file_.Write(&target, sizeof(target));
+
+        if (position[p] < end[p]) {
+            queue.push(MergeHead(ReadVarint(position[p]), p));
+        }
+    }
+
+    return true;
+}
+
+
+/*
+ * Doubles the number of partitions, splitting each by the next bit of the
+ *   hash, once a partition holds more than a quarter of the memory budget
+ *   (loading it builds a table of about twice that size)
+ */
+template <int W>
+bool SpillExplorer<W>::SplitPartitions(std::string &error) {
+
+    if (partition_bits_ == MAX_SPILL_PARTITION_BITS) {
+        return true;
+    }
+
+    bool too_large = false;
+    for (Partition *partition : partitions_) {
+        too_large |= partition->trees.GetSize() > memory_budget_ / 4;
+    }
+    if (!too_large) {
+        return true;
+    }
+
+    std::string trees_name = "index" + std::to_string(partition_bits_ + 1) +
+        "-trees";
+    std::string ids_name = "index" + std::to_string(partition_bits_ + 1) +
+        "-ids";
+
+    std::vector<Partition *> split;
+    for (int p = 0; p < 2 * (int) partitions_.size(); p++) {
+        Partition *partition = new Partition();
+        partition->trees.SetPath(SpillPath(trees_name, p));
+        partition->ids.SetPath(SpillPath(ids_name, p));
+        split.push_back(partition);
+    }
+
+    bool ok = true;
+    for (int p = 0; p < (int) partitions_.size() && ok; p++) {
+        Partition *halves[2] = { split[2 * p], split[2 * p + 1] };
+
+        MappedFile index, ids;
+        if (!partitions_[p]->trees.Map(index) || !partitions_[p]->ids.Map(ids)) {
+            ok = SpillError(partitions_[p]->trees, "read", error);
+            break;
+        }
+
+        for (Partition *half : halves) {
+            if (!half->trees.Create(ChunkSize()) ||
+                !half->ids.Create(ChunkSize())) {
+                ok = SpillError(half->trees, "create", error);
+            }
+        }
+        if (!ok) {
+            break;
+        }
+
+        const uint8_t *data = (const uint8_t *) index.GetData();
+        const uint8_t *end = data + index.GetSize();
+        const uint32_t *id = (const uint32_t *) ids.GetData();
+
+        while (data < end) {
+            const uint8_t *record = data;
+            uint64_t hash;
+            memcpy(&hash, data, sizeof(hash));
+            data += sizeof(hash);
+            int length = (int) ReadVarint(data);
+            data += length;
+
+            Partition *half = halves[(hash >> (63 - partition_bits_)) & 1];
+            half->trees.Write(record, data - record);
+            half->ids.Write(id++, sizeof(uint32_t));
+        }
+
+        for (Partition *half : halves) {
+            if (!half->trees.Close() || !half->ids.Close()) {
+                ok = SpillError(half->trees, "write", error);
+            }
+        }
+    }
+
+    if (!ok) {
+        for (Partition *partition : split) {
+            delete partition;
+        }
+        return false;
+    }
+
+    for (Partition *partition : partitions_) {
+        delete partition;
+    }
+    partitions_ = split;
+    partition_bits_++;
+    return true;
+}
+
+
+// ============================ Writing the result ========================== //
+
+/*
+ * Streams the result into out: the transitions straight from the transition
+ *   file, the Rabin pairs from the label masks (as many labels per pass over
+ *   the masks as the memory budget holds bitvectors for), & the trees decoded
+ *   one at a time from the tree file.
+ */
+template <int W>
+bool SpillExplorer<W>::WriteRabin(OutputBuffer &out,
+    const char *input_file_name, std::string &error) {
+
+    MappedFile transitions, labels, trees;
+    if (!transition_file_.Map(transitions)) {
+        return SpillError(transition_file_, "read", error);
+    }
+    if (!label_file_.Map(labels)) {
+        return SpillError(label_file_, "read", error);
+    }
+    if (!tree_file_.Map(trees)) {
+        return SpillError(tree_file_, "read", error);
+    }
+
+    int alphabet_size = automaton_->GetAlphabetSize();
+
+    WriteRabinHeader(out, input_file_name, num_states_, alphabet_size);
+
+    const uint32_t *successors = (const uint32_t *) transitions.GetData();
+    for (int state = 0; state < num_states_; state++) {
+        WriteRabinTransitions(out, state,
+            &successors[(uint64_t) state * alphabet_size], alphabet_size);
+    }
+
+    WriteRabinInitialState(out, 0);
+
+    // Each state's masks: 2W words of unused (or renamed) labels, then 2W
+    //   words of marked labels
+    const uint64_t *masks = (const uint64_t *) labels.GetData();
+    int num_labels = 2*automaton_->GetNumStates();
+    int num_words = (num_states_ + BITS_PER_WORD - 1) / BITS_PER_WORD;
+
+    size_t pair_bytes = 2 * (size_t) num_words * sizeof(uint64_t);
+    int group = (int) std::min<size_t>(num_labels,
+        std::max<size_t>(1, memory_budget_ / pair_bytes));
+
+    std::vector<uint64_t> left, right;
+
+    for (int first = 0; first < num_labels; first += group) {
+        int count = std::min(group, num_labels - first);
+        left.assign((size_t) count * num_words, 0);
+        right.assign((size_t) count * num_words, 0);
+
+        for (int state = 0; state < num_states_; state++) {
+            const uint64_t *unused = &masks[(uint64_t) state * 4 * W];
+            const uint64_t *marked = unused + 2 * W;
+            uint64_t bit = (uint64_t) 1 << (state % BITS_PER_WORD);
+
+            for (int i = 0; i < count; i++) {
+                int label = first + i;
+                int w = label / BITS_PER_WORD;
+                uint64_t label_bit = (uint64_t) 1 << (label % BITS_PER_WORD);
+                size_t word = (size_t) i * num_words + state / BITS_PER_WORD;
+
+                if (unused[w] & label_bit) { left[word] |= bit; }
+                if (marked[w] & label_bit) { right[word] |= bit; }
+            }
+        }
+
+        for (int i = 0; i < count; i++) {
+            const uint64_t *label_right = &right[(size_t) i * num_words];
+
+            // Only write a Rabin pair if the right side isn't empty
+            bool right_empty = true;
+            for (int w = 0; w < num_words && right_empty; w++) {
+                right_empty = (label_right[w] == 0);
+            }
+            if (!right_empty) {
+                WriteRabinPair(out, &left[(size_t) i * num_words], label_right,
+                    num_words);
+            }
+        }
+    }
+
+    out.WriteLine(END_RABIN_PAIRS_TAG);
+    out.WriteLine(BEGIN_SAFRA_TREES_TAG);
+
+    const uint8_t *data = (const uint8_t *) trees.GetData();
+    for (int state = 0; state < num_states_; state++) {
+        int length = (int) ReadVarint(data);
+        scratch_tree_->Decode(data, length);
+        data += length;
+
+        out.WriteInt(state+1);
+        out.Write(": ", 2);
+        scratch_tree_->WriteTo(out);
+        out.WriteChar('\n');
+    }
+
+    out.WriteLine(END_SAFRA_TREES_TAG);
+    out.WriteLine(RABIN_EOF_TAG);
+    return true;
+}
+
+
+// ================================ Helpers ================================= //
+
+template <int W>
+int SpillExplorer<W>::PartitionOf(const uint64_t &hash) {
+    return (partition_bits_ == 0 ? 0 : (int) (hash >> (64 - partition_bits_)));
+}
+
+/*
+ * <spill directory>/safra-<process id>-<name>-<index>, so that several runs
+ *   can share a spill directory
+ */
+template <int W>
+std::string SpillExplorer<W>::SpillPath(const std::string &name,
+    const int &index) {
+    return spill_directory_ + "/safra-" + std::to_string(getpid()) + "-" +
+        name + "-" + std::to_string(index);
+}
+
+/*
+ * Write buffer of each spill file. Every partition's candidate file is open
+ *   at once, so together they get an eighth of the budget.
+ */
+template <int W>
+size_t SpillExplorer<W>::ChunkSize() {
+    size_t chunk_size = memory_budget_ / (8 * (partitions_.size() + 1));
+    return std::max<size_t>(MIN_SPILL_CHUNK_SIZE,
+        std::min<size_t>(OUTPUT_CHUNK_SIZE, chunk_size));
+}
+
+/*
+ * Updates the statistics with a tree as it is expanded (each tree once)
+ */
+template <int W>
+void SpillExplorer<W>::CountTree(SafraTree<W> *tree) {
+    stats_.max_tree_nodes = std::max(stats_.max_tree_nodes, tree->GetNumNodes());
+    stats_.max_tree_depth = std::max(stats_.max_tree_depth, tree->GetDepth());
+    never_used_labels_ = Labels::Intersect(never_used_labels_,
+        tree->GetUnusedLabels());
+}
+
+
+// Explicit instantiations for every supported state set width
+#define INSTANTIATE_SPILL_EXPLORER(W) template class SpillExplorer<W>;
+SAFRA_FOR_EACH_WIDTH(INSTANTIATE_SPILL_EXPLORER)
+#undef INSTANTIATE_SPILL_EXPLORER
@@ -0,0 +1,198 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *   spill_explorer.h - exploration of the Safra trees in external memory     *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "buechi_automaton.h"
+#include "buechi_reader.h"
+#include "output_buffer.h"
+#include "safra_explorer.h"
+#include "safra_tree.h"
+#include "tree_table.h"
+
+// Bytes of memory the spilling explorer aims to stay within by default
+#define DEFAULT_MEMORY_BUDGET ((size_t) 256 << 20)
+
+// The dedup index is split into at most 2^MAX_SPILL_PARTITION_BITS partitions
+#define MAX_SPILL_PARTITION_BITS 10
+
+/*
+ * An append-only file in the spill directory: written through its own small
+ *   OutputBuffer (only while open), read back by mapping it, & removed when
+ *   the SpillFile goes away.
+ */
+class SpillFile {
+public:
+
+    SpillFile();
+    ~SpillFile();
+
+    void SetPath(const std::string &path);
+
+    // Starts the file over / continues it. Writes go through a buffer of
+    //   chunk_size bytes, which is released again by Close.
+    bool Create(const size_t &chunk_size);
+    bool Append(const size_t &chunk_size);
+    bool Close();
+
+    void Write(const void *data, const size_t &length) {
+        out_->Write((const char *) data, length);
+        size_ += length;
+    }
+
+    void WriteVarint(const uint64_t &value) {
+        size_ += out_->WriteVarint(value);
+    }
+
+    // Maps everything written so far (the file must be closed)
+    bool Map(MappedFile &file);
+
+    // Bytes written to the file since it was last created
+    uint64_t GetSize();
+    const std::string &GetPath();
+
+    void Remove();
+
+private:
+    SpillFile(const SpillFile &);
+    SpillFile &operator=(const SpillFile &);
+
+    std::string path_;
+    OutputBuffer *out_;
+    uint64_t size_;
+    bool exists_;
+};
+
+
+/*
+ * Computes the same Rabin automaton as SafraExplorer (with a single thread),
+ *   keeping about memory_budget bytes in memory & everything else in files
+ *   under spill_directory, so automata whose trees do not fit in memory can
+ *   still be determinized.
+ *
+ * The search runs one BFS level at a time. Every tree found so far is stored
+ *   twice on disk: in id order in the tree file (whose tail is the frontier,
+ *   the level being expanded), & in the dedup index, which is split by the
+ *   top bits of the tree's hash into partitions small enough to be loaded
+ *   into a TreeTable one at a time. A level is processed as
+ *
+ *   (1) every frontier tree is decoded & expanded, & each successor's
+ *       encoding is written to the candidate file of its partition;
+ *   (2) each partition is loaded with its candidates: a candidate that is
+ *       already in the partition resolves to its id, & the first occurrence
+ *       of a new tree becomes a new tree of the partition;
+ *   (3) the partitions' new trees are merged in the order they were first
+ *       reached, which gives them their BFS ids (the numbering SafraExplorer
+ *       assigns) & appends them to the tree file, & the resolved candidates
+ *       are merged back into transition order & appended to the transition
+ *       file.
+ *
+ *   A partition that outgrows its share of the budget makes the index double
+ *   its number of partitions. The transitions, each state's label masks &
+ *   the trees are then streamed straight from their files into the output.
+ */
+template <int W>
+class SpillExplorer {
+public:
+
+    // With canonical_labels, label-isomorphic trees are one state (see
+    //   SafraTree::CanonicalizeLabels)
+    SpillExplorer(const BuchiAutomaton *automaton, bool canonical_labels,
+        const size_t &memory_budget, const char *spill_directory);
+    ~SpillExplorer();
+
+    // Explores the whole reachable state space. Returns false, with a
+    //   description in error, if a spill file cannot be written or read.
+    bool Run(std::string &error);
+
+    // Writes the result in the format of WriteRabin. Returns false, with a
+    //   description in error, if a spill file cannot be read.
+    bool WriteRabin(OutputBuffer &out, const char *input_file_name,
+        std::string &error);
+
+    // Counters of the Run (the table counters are summed over every load of
+    //   a partition)
+    ExplorerStats GetStats();
+    int GetNumStates();
+
+private:
+    SpillExplorer(const SpillExplorer &);
+    SpillExplorer &operator=(const SpillExplorer &);
+
+    typedef typename SafraTree<W>::Labels Labels;
+
+    // One part of the dedup index: the encodings of its trees (hash & key)
+    //   & their ids, in the same order
+    struct Partition {
+        SpillFile trees;
+        SpillFile ids;
+    };
+
+    // Per-partition files of the level being processed: the candidates of
+    //   (1), & the resolved candidates & new trees of (2)
+    struct LevelFiles {
+        SpillFile candidates;
+        SpillFile resolved;
+        SpillFile new_trees;
+    };
+
+    bool ExpandLevel(std::string &error);
+    bool ResolvePartition(const int &p, std::string &error);
+    bool NumberNewTrees(std::string &error);
+    bool MergeTransitions(std::string &error);
+    bool SplitPartitions(std::string &error);
+
+    int PartitionOf(const uint64_t &hash);
+    std::string SpillPath(const std::string &name, const int &index);
+    size_t ChunkSize();
+    void CountTree(SafraTree<W> *tree);
+
+    const BuchiAutomaton *automaton_;
+    bool canonical_labels_;
+    size_t memory_budget_;
+    std::string spill_directory_;
+
+    SafraArena<W> arena_;
+    SafraTree<W> *scratch_tree_;
+    std::vector<SafraTree<W> *> successor_trees_;
+    std::vector<uint8_t> key_;
+
+    // The index: 2^partition_bits_ partitions, & the table a partition is
+    //   loaded into, along with the ids of its entries
+    int partition_bits_;
+    std::vector<Partition *> partitions_;
+    std::vector<LevelFiles *> level_files_;
+    TreeTable table_;
+    std::vector<uint32_t> table_ids_;
+
+    // ids of the new trees of each partition in the current level, in the
+    //   order the partition found them
+    std::vector<std::vector<uint32_t>> new_ids_;
+
+    // Every tree in id order (length & key), its label masks (unused or
+    //   renamed, then marked), & the successors of every expanded state
+    SpillFile tree_file_;
+    SpillFile label_file_;
+    SpillFile transition_file_;
+
+    // The frontier: ids [level_start_, num_states_) & their byte range in the
+    //   tree file
+    int level_start_;
+    int num_states_;
+    uint64_t frontier_offset_;
+
+    ExplorerStats stats_;
+    Labels never_used_labels_;
+};
@@ -0,0 +1,145 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *          state_set.h - fixed-width bitvector sets of Buechi states         *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Number of bits held by a single word of a state set
+#define BITS_PER_WORD 64
+
+// Applies X to every state set width (in words) the Safra construction is
+//   compiled for. The widest entry bounds the number of Buechi states we accept.
+#define SAFRA_FOR_EACH_WIDTH(X) X(1) X(2) X(4) X(8) X(16)
+#define MAX_STATE_WORDS 16
+#define MAX_BUECHI_STATES (MAX_STATE_WORDS * BITS_PER_WORD)
+
+// Bit tricks used for iterating over the members of a set
+inline int PopCount(const uint64_t &word) {
+    return __builtin_popcountll(word);
+}
+
+inline int LowestBit(const uint64_t &word) {
+    return __builtin_ctzll(word);
+}
+
+/*
+ * Returns the smallest compiled state set width (in words) that can hold
+ *   num_states states, or -1 if the automaton is too large.
+ */
+inline int StateWordsFor(const int &num_states) {
+    int words = 1;
+    while (words * BITS_PER_WORD < num_states) {
+        words *= 2;
+    }
+    return (words <= MAX_STATE_WORDS ? words : -1);
+}
+
+/*
+ * A set of Buechi states stored as a bitvector of WORDS 64-bit words. State i
+ *   is in the set iff bit (i % 64) of word (i / 64) is set. All operations are
+ *   plain word-wise loops over a fixed-size array, so for a given width they
+ *   unroll into the same handful of instructions the single-word version used.
+ */
+template <int WORDS>
+class StateSet {
+public:
+
+    StateSet() {
+        for (int w = 0; w < WORDS; w++) { words_[w] = 0; }
+    }
+
+    // Builds a set from WORDS consecutive words starting at words
+    static StateSet FromWords(const uint64_t *words) {
+        StateSet set;
+        memcpy(set.words_, words, sizeof(set.words_));
+        return set;
+    }
+
+    // Set operations
+    static StateSet Union(const StateSet &x, const StateSet &y) {
+        StateSet set;
+        for (int w = 0; w < WORDS; w++) { set.words_[w] = x.words_[w] | y.words_[w]; }
+        return set;
+    }
+
+    static StateSet Intersect(const StateSet &x, const StateSet &y) {
+        StateSet set;
+        for (int w = 0; w < WORDS; w++) { set.words_[w] = x.words_[w] & y.words_[w]; }
+        return set;
+    }
+
+    static StateSet Complement(const StateSet &x) {
+        StateSet set;
+        for (int w = 0; w < WORDS; w++) { set.words_[w] = ~x.words_[w]; }
+        return set;
+    }
+
+    static StateSet Difference(const StateSet &x, const StateSet &y) {
+        StateSet set;
+        for (int w = 0; w < WORDS; w++) { set.words_[w] = x.words_[w] & ~y.words_[w]; }
+        return set;
+    }
+
+    bool Contains(const int &i) const {
+        return ((words_[i / BITS_PER_WORD] >> (i % BITS_PER_WORD)) & 1) == 1;
+    }
+
+    void Insert(const int &i) {
+        words_[i / BITS_PER_WORD] |= (uint64_t(1) << (i % BITS_PER_WORD));
+    }
+
+    void Remove(const int &i) {
+        words_[i / BITS_PER_WORD] &= ~(uint64_t(1) << (i % BITS_PER_WORD));
+    }
+
+    // In-place union with the WORDS words starting at words
+    void UnionWith(const uint64_t *words) {
+        for (int w = 0; w < WORDS; w++) { words_[w] |= words[w]; }
+    }
+
+    // Returns the smallest member of the set, or -1 if the set is empty
+    int Lowest() const {
+        for (int w = 0; w < WORDS; w++) {
+            if (words_[w] != 0) { return w * BITS_PER_WORD + LowestBit(words_[w]); }
+        }
+        return -1;
+    }
+
+    int Count() const {
+        int count = 0;
+        for (int w = 0; w < WORDS; w++) { count += PopCount(words_[w]); }
+        return count;
+    }
+
+    bool IsEmpty() const {
+        uint64_t any = 0;
+        for (int w = 0; w < WORDS; w++) { any |= words_[w]; }
+        return any == 0;
+    }
+
+    bool operator==(const StateSet &other) const {
+        uint64_t diff = 0;
+        for (int w = 0; w < WORDS; w++) { diff |= words_[w] ^ other.words_[w]; }
+        return diff == 0;
+    }
+
+    bool operator!=(const StateSet &other) const {
+        return !(*this == other);
+    }
+
+    // Raw word access
+    uint64_t GetWord(const int &w) const { return words_[w]; }
+    const uint64_t *GetWords() const { return words_; }
+
+private:
+    uint64_t words_[WORDS];
+};
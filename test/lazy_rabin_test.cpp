@@ -0,0 +1,158 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *   lazy_rabin_test.cpp - checks LazyRabin against Determinize (libsafra)    *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../safra.h"
+#include "../lazy_rabin.h"
+#include "../hoa_reader.h"
+
+/*
+ * Explores lazy in BFS order (states in the order they were numbered, letters
+ *   in increasing order), which numbers the states exactly as Determinize
+ *   does, and checks every successor, Rabin pair membership & Safra tree
+ *   against result. Returns a description of the first difference, or "".
+ */
+template <int W>
+std::string CompareWithWidth(const BuchiAutomaton &automaton,
+    bool canonical_labels, const SafraResult &result) {
+
+    const RabinAutomaton &rabin = result.rabin;
+    LazyRabin<W> lazy(&automaton, canonical_labels, SafraAllocator());
+    char message[256];
+
+    if (lazy.GetInitialState() != rabin.GetInitialState()) {
+        return "initial states differ";
+    }
+
+    for (int state = 0; state < lazy.GetNumStates(); state++) {
+
+        if (state >= rabin.GetNumStates()) {
+            return "LazyRabin has more states";
+        }
+
+        for (int c = 0; c < lazy.GetAlphabetSize(); c++) {
+            int post_state = lazy.GetSuccessor(state, c);
+            if (post_state != (int) rabin.GetSuccessor(state, c)) {
+                snprintf(message, sizeof(message), "successor of state %d "
+                    "along letter %d: %d instead of %d", state + 1, c + 1,
+                    post_state + 1, (int) rabin.GetSuccessor(state, c) + 1);
+                return message;
+            }
+        }
+
+        uint64_t bit = uint64_t(1) << (state % 64);
+        for (int label = 0; label < lazy.GetNumLabels(); label++) {
+            bool left = (rabin.GetLeft(label)[state / 64] & bit) != 0;
+            bool right = (rabin.GetRight(label)[state / 64] & bit) != 0;
+
+            if (lazy.GetLeftLabels(state).Contains(label) != left ||
+                lazy.GetRightLabels(state).Contains(label) != right) {
+                snprintf(message, sizeof(message), "state %d in the Rabin pair "
+                    "of label %d", state + 1, label + 1);
+                return message;
+            }
+        }
+
+        if (lazy.GetTree(state)->ToString() != result.safra_trees[state]) {
+            snprintf(message, sizeof(message), "Safra tree of state %d",
+                state + 1);
+            return message;
+        }
+    }
+
+    if (lazy.GetNumStates() != rabin.GetNumStates()) {
+        return "Determinize has more states";
+    }
+    return "";
+}
+
+/*
+ * Determinizes automaton with Determinize & compares it with a LazyRabin of
+ *   the state set width Determinize picked
+ */
+std::string Compare(const BuchiAutomaton &automaton, bool canonical_labels) {
+
+    SafraOptions options;
+    options.canonical_labels = canonical_labels;
+    options.keep_trees = true;
+
+    SafraResult result;
+    std::string error;
+    if (!Determinize(automaton, options, result, error)) {
+        return "Determinize failed (" + error + ")";
+    }
+
+    switch (automaton.GetNumWords()) {
+#define COMPARE_WITH_WIDTH(W)                                                   \
+        case W:                                                                 \
+            return CompareWithWidth<W>(automaton, canonical_labels, result);
+        SAFRA_FOR_EACH_WIDTH(COMPARE_WITH_WIDTH)
+#undef COMPARE_WITH_WIDTH
+        default:
+            break;
+    }
+    return "no state set width";
+}
+
+
+int main(int argc, const char *argv[]) {
+
+    if (argc < 2) {
+        printf("Usage: ./test/lazy_rabin_test <inputfile> ...\n");
+        return 1;
+    }
+
+    int failures = 0;
+
+    for (int i = 1; i < argc; i++) {
+        MappedFile file;
+        BuchiAutomaton automaton;
+        int num_states;
+        std::vector<std::string> atomic_propositions;
+        std::string error;
+
+        bool parsed = file.Open(argv[i]);
+        if (!parsed) {
+            error = "cannot open the file";
+        }
+        else if (IsHoa(file.GetData(), file.GetSize())) {
+            parsed = ParseHoa(file.GetData(), file.GetSize(), automaton,
+                num_states, atomic_propositions, error);
+        }
+        else {
+            parsed = ParseBuechi(file.GetData(), file.GetSize(), automaton,
+                num_states, error);
+        }
+        if (!parsed) {
+            printf("FAIL: %s (cannot read it: %s)\n", argv[i], error.c_str());
+            failures++;
+            continue;
+        }
+
+        for (int canonical = 0; canonical < 2; canonical++) {
+            std::string difference = Compare(automaton, canonical);
+            const char *mode = (canonical ? ", canonical labels" : "");
+
+            if (difference.empty()) {
+                printf("PASS: LazyRabin %s%s\n", argv[i], mode);
+            }
+            else {
+                printf("FAIL: LazyRabin %s%s (%s)\n", argv[i], mode,
+                    difference.c_str());
+                failures++;
+            }
+        }
+    }
+
+    return (failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,147 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *     tree_table.cpp - hash table deduplicating encoded Safra trees by key   *
+ *                                                                            *
+ * ************************************************************************** */
+
+#include <cstring>
+#include <cassert>
+
+#include "tree_table.h"
+
+#define INITIAL_TABLE_SIZE 1024
+
+TreeTable::TreeTable() {
+    Clear();
+}
+
+/*
+ * The slots go back to their initial size, so clearing a table that grew
+ *   large does not make every later use pay for its size
+ */
+void TreeTable::Clear() {
+    Slot empty = { 0, -1 };
+    slots_.assign(INITIAL_TABLE_SIZE, empty);
+    mask_ = INITIAL_TABLE_SIZE - 1;
+
+    key_pool_.clear();
+    key_offsets_.clear();
+    key_offsets_.push_back(0);
+
+    num_lookups_ = 0;
+    num_probes_ = 0;
+    max_probe_ = 0;
+}
+
+
+/*
+ * Probes for key starting at its home slot. If an equal key is found its id is
+ *   returned; otherwise the key is appended to the pool and takes the first
+ *   empty slot on the probe sequence.
+ */
+int TreeTable::Insert(const uint8_t *key, const int &length,
+    const uint64_t &hash, bool &inserted) {
+
+    // Keep the load factor at or below 1/2 so probe sequences stay short
+    if (2 * (Size() + 1) > (int) slots_.size()) {
+        Grow();
+    }
+
+    uint32_t check = (uint32_t) hash;
+    uint64_t i = check & mask_;
+    int probe = 1;
+    while (slots_[i].id != -1) {
+        if (slots_[i].hash == check && KeyEquals(slots_[i].id, key, length)) {
+            CountProbe(probe);
+            inserted = false;
+            return slots_[i].id;
+        }
+        i = (i + 1) & mask_;
+        probe++;
+    }
+    CountProbe(probe);
+
+    int id = Size();
+    key_pool_.insert(key_pool_.end(), key, key + length);
+    key_offsets_.push_back(key_pool_.size());
+
+    slots_[i].hash = check;
+    slots_[i].id = id;
+
+    inserted = true;
+    return id;
+}
+
+
+int TreeTable::Size() const {
+    return key_offsets_.size() - 1;
+}
+
+int TreeTable::GetCapacity() const {
+    return slots_.size();
+}
+
+uint64_t TreeTable::GetNumLookups() const {
+    return num_lookups_;
+}
+
+uint64_t TreeTable::GetNumProbes() const {
+    return num_probes_;
+}
+
+int TreeTable::GetMaxProbe() const {
+    return max_probe_;
+}
+
+const uint8_t *TreeTable::GetKey(const int &id) const {
+    assert(id >= 0 && id < Size());
+    return &key_pool_[key_offsets_[id]];
+}
+
+int TreeTable::GetKeyLength(const int &id) const {
+    assert(id >= 0 && id < Size());
+    return key_offsets_[id + 1] - key_offsets_[id];
+}
+
+
+// ========================= Private helper methods ========================= //
+
+bool TreeTable::KeyEquals(const int &id, const uint8_t *key,
+    const int &length) const {
+
+    return GetKeyLength(id) == length && memcmp(GetKey(id), key, length) == 0;
+}
+
+void TreeTable::CountProbe(const int &probe) {
+    num_lookups_++;
+    num_probes_ += probe;
+    if (probe > max_probe_) {
+        max_probe_ = probe;
+    }
+}
+
+/*
+ * Doubles the number of slots and reinserts every id. The stored hashes make
+ *   this a pure slot shuffle; no key is rehashed or compared.
+ */
+void TreeTable::Grow() {
+
+    Slot empty = { 0, -1 };
+    std::vector<Slot> old_slots(slots_.size() * 2, empty);
+    old_slots.swap(slots_);
+    mask_ = slots_.size() - 1;
+
+    for (const Slot &slot : old_slots) {
+        if (slot.id != -1) {
+            uint64_t i = slot.hash & mask_;
+            while (slots_[i].id != -1) {
+                i = (i + 1) & mask_;
+            }
+            slots_[i] = slot;
+        }
+    }
+}
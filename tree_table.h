@@ -0,0 +1,110 @@
+/* ************************************************************************** *
+ *                                                                            *
+ *                15-354: Computational Discrete Mathematics                  *
+ *                     Final Project: Safra's Algorithm                       *
+ *             Erik Sargent (esargent), Vaidehi Srinivas (vaidehis)           *
+ *                                                                            *
+ *      tree_table.h - hash table deduplicating encoded Safra trees by key    *
+ *                                                                            *
+ * ************************************************************************** */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
+ * Folds one more value of a tree encoding into a running 64-bit hash. Trees
+ *   hash their encoding value by value while writing it, so no second pass
+ *   over the key is needed before a lookup.
+ */
+inline uint64_t HashWord(uint64_t hash, const uint64_t &word) {
+    hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+    return hash ^ (hash >> 29);
+}
+
+#define HASH_SEED 0xcbf29ce484222325ULL
+
+/*
+ * Variable-length integers for the compact tree encoding: 7 bits per byte,
+ *   least significant first, with the high bit set on every byte but the
+ *   last. Values below 128 take a single byte.
+ */
+inline void WriteVarint(std::vector<uint8_t> &bytes, uint64_t value) {
+    while (value >= 0x80) {
+        bytes.push_back((uint8_t) (value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back((uint8_t) value);
+}
+
+inline uint64_t ReadVarint(const uint8_t *&bytes) {
+    uint64_t value = 0;
+    for (int shift = 0; ; shift += 7) {
+        uint8_t byte = *bytes++;
+        value |= (uint64_t) (byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return value;
+        }
+    }
+}
+
+/*
+ * Open-addressing (linear probing) hash table mapping canonical tree encodings
+ *   to dense ids 0, 1, 2, ... in insertion order. Keys are byte strings copied
+ *   into one append-only pool, which is also where explored trees live between
+ *   being found and being expanded. A slot only holds 32 bits of the key's
+ *   hash and its id, so probing touches a single cache line in the common case
+ *   and equality is a memcmp.
+ */
+class TreeTable {
+public:
+
+    TreeTable();
+
+    // Returns the id of the given key, assigning the next free id (and setting
+    //   inserted to true) if it has not been seen before
+    int Insert(const uint8_t *key, const int &length, const uint64_t &hash,
+        bool &inserted);
+
+    int Size() const;
+
+    // Removes every key, keeping the key pool's memory for the next use
+    void Clear();
+
+    // Probe statistics (for --stats): number of slots, Insert calls, slots
+    //   inspected by them in total, and the longest single probe sequence
+    int GetCapacity() const;
+    uint64_t GetNumLookups() const;
+    uint64_t GetNumProbes() const;
+    int GetMaxProbe() const;
+
+    // Access to the stored encoding of the tree with the given id. The
+    //   pointer is invalidated by the next Insert.
+    const uint8_t *GetKey(const int &id) const;
+    int GetKeyLength(const int &id) const;
+
+private:
+
+    // Only the low 32 bits of the hash are kept: they pick the home slot &
+    //   filter out most unequal keys
+    struct Slot {
+        uint32_t hash;
+        int id;         // -1 if the slot is empty
+    };
+
+    bool KeyEquals(const int &id, const uint8_t *key, const int &length) const;
+    void CountProbe(const int &probe);
+    void Grow();
+
+    std::vector<Slot> slots_;
+    uint64_t mask_;
+
+    uint64_t num_lookups_;
+    uint64_t num_probes_;
+    int max_probe_;
+
+    std::vector<uint8_t> key_pool_;
+    std::vector<size_t> key_offsets_;   // key i is [offsets[i], offsets[i+1])
+};